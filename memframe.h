@@ -0,0 +1,265 @@
+//
+// memframe.h
+//
+#pragma once
+
+#include "memvar.h"
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// basicMemframe
+// a group of memvars written together: each write stores a row with one
+// value per column, and one time tag shared by the whole row
+// the columns are kept in separate histories, so a column can be read as
+// the history of a memvar, and the time tags in one more history, so that
+// a row costs one clock read and one time tag whatever the number of columns
+// each column type is restricted as the type of a memvar
+template <typename Time, typename Clock, typename... Ts>
+class basicMemframe : public memvarBase {
+  static_assert(sizeof...(Ts) > 0, "At least one column required.");
+
+ public:
+  using row = std::tuple<Ts...>;
+  using timePoint = std::chrono::time_point<Clock, Time>;
+  using historyTimedRow = std::tuple<row, Time, bool>;
+  template <size_t I>
+  using columnType = std::tuple_element_t<I, row>;
+
+  static constexpr size_t columnCount_ {sizeof...(Ts)};
+
+  basicMemframe() :
+  basicMemframe(row{}, historyCapacityDefault_)
+  {}
+
+  explicit basicMemframe(const row& values,
+                         const capacityType historyCapacity = historyCapacityDefault_) :
+  memvarBase(historyCapacity) {
+    checkTypes();
+    checkHistoryCapacity(historyCapacity_);
+    // store the time point epoch for the memframe
+    memvarEpoch_ = Clock::now();
+    setRowAt(values, memvarEpoch_);
+  }
+
+  basicMemframe(const basicMemframe& rhs) = delete;
+  basicMemframe& operator=(const basicMemframe& rhs) = delete;
+  // moving steals the column and time tag histories
+  basicMemframe(basicMemframe&& rhs) = default;
+  basicMemframe& operator=(basicMemframe&& rhs) = default;
+
+  ~basicMemframe() override = default;
+
+  basicMemframe& operator=(const row& values) {
+    setRow(values);
+    return *this;
+  }
+
+  void setRow(const Ts&... values) {
+    storeRow(Clock::now(), values...);
+  }
+
+  void setRow(const row& values) {
+    setRowAt(values, Clock::now());
+  }
+
+  // store a row with a time point taken elsewhere
+  void setRowAt(const row& values, const timePoint& when) {
+    std::apply([this, &when] (const Ts&... columnValues) {
+      storeRow(when, columnValues...);
+    }, values);
+  }
+
+  row operator()() const {
+    return getRow(0);
+  }
+
+  row operator()(const capacityType index) const {
+    return std::get<row>(getHistoryRow(index));
+  }
+
+  // the value of column I in the index-th row
+  template <size_t I>
+  columnType<I> get(const capacityType index = 0) const {
+    return std::get<I>(columns_).at(static_cast<size_t>(index));
+  }
+
+  // the history of column I, from newest to oldest value, as the history of
+  // a memvar
+  template <size_t I>
+  const auto& getColumnHistory() const noexcept {
+    return std::get<I>(columns_);
+  }
+
+  // the time tag for the i-th row in the history is the time duration
+  // measured in Time units from the memframe time point epoch
+  Time getTimeTag(const size_t index = 0) const {
+    return std::chrono::duration_cast<Time>(timeMemo_.at(index) - memvarEpoch_);
+  }
+
+  auto getHistoryRow(const capacityType index) const -> historyTimedRow {
+    if ( (index < getHistorySize()) && (index >= 0) ) {
+      return std::make_tuple(getRow(static_cast<size_t>(index)),
+                             getTimeTag(static_cast<size_t>(index)),
+                             false);
+    }
+    return std::make_tuple(row{}, Time{0}, true);
+  }
+
+  // copy the n newest rows of the history to out, in the given order
+  // returns the number of rows copied: n is capped by the history size and
+  // by the size of out
+  capacityType copyRowsTo(std::span<row> out,
+                          capacityType n,
+                          const historyOrder order = historyOrder::newestFirst) const {
+    n = std::min({n, getHistorySize(), static_cast<capacityType>(out.size())});
+    if ( n <= 0 ) {
+      return 0;
+    }
+    copyColumnsTo(out, n, std::index_sequence_for<Ts...>{});
+    if ( historyOrder::oldestFirst == order ) {
+      std::reverse(out.begin(), out.begin() + n);
+    }
+    return n;
+  }
+
+  // copy the n newest values of column I to out, in the given order
+  template <size_t I>
+  capacityType copyColumnTo(std::span<columnType<I>> out,
+                            capacityType n,
+                            const historyOrder order = historyOrder::newestFirst) const {
+    const auto& column {std::get<I>(columns_)};
+    n = std::min({n, getHistorySize(), static_cast<capacityType>(out.size())});
+    if ( n <= 0 ) {
+      return 0;
+    }
+    std::copy_n(column.cbegin(), n, out.begin());
+    if ( historyOrder::oldestFirst == order ) {
+      std::reverse(out.begin(), out.begin() + n);
+    }
+    return n;
+  }
+
+  capacityType getHistorySize() const noexcept {
+    return static_cast<capacityType>(timeMemo_.size());
+  }
+
+  auto isHistoryFull() const noexcept {
+    return getHistorySize() >= historyCapacity_;
+  }
+
+  // change the history capacity keeping the history: shrinking evicts the
+  // oldest rows that do not fit the new capacity
+  void setHistoryCapacity(const capacityType historyCapacity) {
+    checkHistoryCapacity(historyCapacity);
+    if ( historyCapacity < getHistorySize() ) {
+      const auto size {static_cast<size_t>(historyCapacity)};
+      forEachColumn([this, size] (auto& column, auto& retiredColumn) {
+        retiredColumn.trim(column, size, reclaimPolicy_);
+      });
+      retiredTimeMemo_.trim(timeMemo_, size, reclaimPolicy_);
+    }
+    historyCapacity_ = historyCapacity;
+  }
+
+  // the histories are handed over to the reclaim policy as in a memvar, and
+  // the time point epoch is reset with a row of default values
+  void clearHistory() {
+    forEachColumn([this] (auto& column, auto& retiredColumn) {
+      retiredColumn.retire(column, reclaimPolicy_);
+    });
+    retiredTimeMemo_.retire(timeMemo_, reclaimPolicy_);
+    memvarEpoch_ = Clock::now();
+    setRowAt(row{}, memvarEpoch_);
+  }
+
+  void printHistoryData(std::ostream& os = std::cout, const std::string& separator = std::string("\n")) const {
+    textWriter out {os, textWriter::streamFormat {}};
+    out.write("{ --- begin ---\n[TimeTag:Values]\n");
+    for (size_t i {0}; i < timeMemo_.size(); ++i) {
+      out.put('[');
+      out.writeValue(getTimeTag(i).count());
+      out.put(':');
+      printRow(out, i, std::index_sequence_for<Ts...>{});
+      out.put(']');
+      out.write(separator);
+    }
+    out.write("  --- end --- }\n\n");
+  }
+
+ private:
+  using memvarTimeHistory = std::deque<timePoint>;
+
+  std::tuple<std::deque<Ts>...> columns_ {};
+  std::tuple<retiredHistory<std::deque<Ts>>...> retiredColumns_ {};
+  memvarTimeHistory timeMemo_ {};
+  retiredHistory<memvarTimeHistory> retiredTimeMemo_ {};
+  timePoint memvarEpoch_ {};
+
+  static void checkTypes() {
+    static_assert(((std::is_integral_v<Ts> ||
+                    std::is_floating_point_v<Ts> ||
+                    is_string_v<Ts> ||
+                    is_bigint_v<Ts>) && ...),
+                  "String, integral, floating point, or bigint types required.");
+  }
+
+  void storeRow(const timePoint& when, const Ts&... values) {
+    releaseRetired();
+    std::apply([&values...] (auto&... column) {
+      (column.emplace_front(values), ...);
+    }, columns_);
+    timeMemo_.emplace_front(when);
+    if ( getHistorySize() > historyCapacity_ ) {
+      std::apply([] (auto&... column) {
+        (column.pop_back(), ...);
+      }, columns_);
+      timeMemo_.pop_back();
+    }
+  }
+
+  void releaseRetired() noexcept {
+    forEachColumn([] (auto&, auto& retiredColumn) {
+      if ( !retiredColumn.empty() ) {
+        retiredColumn.release();
+      }
+    });
+    if ( !retiredTimeMemo_.empty() ) {
+      retiredTimeMemo_.release();
+    }
+  }
+
+  // call f(column, retiredColumn) for each column
+  template <typename F>
+  void forEachColumn(F&& f) {
+    forEachColumn(f, std::index_sequence_for<Ts...>{});
+  }
+
+  template <typename F, size_t... Is>
+  void forEachColumn(F& f, std::index_sequence<Is...>) {
+    (f(std::get<Is>(columns_), std::get<Is>(retiredColumns_)), ...);
+  }
+
+  row getRow(const size_t index) const {
+    return std::apply([index] (const auto&... column) {
+      return row {column.at(index)...};
+    }, columns_);
+  }
+
+  template <size_t... Is>
+  void copyColumnsTo(std::span<row> out, const capacityType n, std::index_sequence<Is...>) const {
+    for (capacityType i {0}; i < n; ++i) {
+      ((std::get<Is>(out[static_cast<size_t>(i)]) = std::get<Is>(columns_)[static_cast<size_t>(i)]), ...);
+    }
+  }
+
+  template <size_t... Is>
+  void printRow(textWriter& out, const size_t index, std::index_sequence<Is...>) const {
+    ((out.write(Is == 0 ? "" : ","), out.writeValue(std::get<Is>(columns_)[index])), ...);
+  }
+};  // class basicMemframe
+
+// memframe
+// a basicMemframe time tagged as a memvarTimed by default
+template <typename... Ts>
+using memframe = basicMemframe<std::chrono::nanoseconds, std::chrono::high_resolution_clock, Ts...>;
+}  // namespace memvar
@@ -4,47 +4,54 @@
 #pragma once
 
 #include "is_string.h"
+#include "memvarUtf8.h"
+#include "memvarText.h"
 #include <concepts>
 #include <type_traits>
 #include <cstdint>
 #include <iostream>
 #include <string>
-#include <codecvt>
-#include <locale>
 #include <tuple>
 #include <deque>
+#include <span>
+#include <iterator>
 #include <chrono>
 #include <algorithm>
 #include <stdexcept>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stop_token>
+#include <functional>
+#include <utility>
+#include <string_view>
+#include <cmath>
+#include <limits>
 ////////////////////////////////////////////////////////////////////////////////
 // Forward declaration for bigint.h here, used in unit tests
 namespace bip { class bigint; }
 
 // Overload for std::wstring
-std::ostream& operator<<(std::ostream& os, const std::wstring& s) {
-  // std::wstring_convert: C++17 deprecated, but no replacement defined yet
-  std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
-  return os << conv.to_bytes(s);
+inline std::ostream& operator<<(std::ostream& os, const std::wstring& s) {
+  return memvar::writeUtf8(os, std::wstring_view(s));
 }
 
 // Overload for std::u8string (C++20)
 // Memory layout is the same as char, so a simple reinterpret_cast works perfectly.
-std::ostream& operator<<(std::ostream& os, const std::u8string& s) {
+inline std::ostream& operator<<(std::ostream& os, const std::u8string& s) {
   return os << reinterpret_cast<const char*>(s.c_str());
 }
 
 // Overload for std::u16string
-std::ostream& operator<<(std::ostream& os, const std::u16string& s) {
-  // std::wstring_convert: C++17 deprecated, but no replacement defined yet
-  std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> conv;
-  return os << conv.to_bytes(s);
+inline std::ostream& operator<<(std::ostream& os, const std::u16string& s) {
+  return memvar::writeUtf8(os, std::u16string_view(s));
 }
 
 // Overload for std::u32string
-std::ostream& operator<<(std::ostream& os, const std::u32string& s) {
-  // std::wstring_convert: C++17 deprecated, but no replacement defined yet
-  std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> conv;
-  return os << conv.to_bytes(s);
+inline std::ostream& operator<<(std::ostream& os, const std::u32string& s) {
+  return memvar::writeUtf8(os, std::u32string_view(s));
 }
 
 namespace memvar
@@ -72,29 +79,353 @@ concept AnyStandardString = IsAnyOf<std::remove_cvref_t<T>,
                                     std::u16string,
                                     std::u32string>;
 
+// Order of the values copied out of a history
+enum class historyOrder {
+  newestFirst,  // from newest/last value to oldest/first value
+  oldestFirst   // from oldest/first value to newest/last value
+};
+
+// How the memory of a cleared history is given back
+enum class reclaimPolicy {
+  immediate,  // deallocated by clearHistory()
+  deferred,   // released a few values at a time by the writes that follow, the default
+  background  // deallocated by the background history reclaimer thread
+};
+
+// historyReclaimer
+// a background thread destroying the histories handed over to it, so that
+// the thread clearing a history does not pay for its deallocation
+class historyReclaimer {
+ public:
+  static historyReclaimer& instance() {
+    static historyReclaimer reclaimer {};
+    return reclaimer;
+  }
+
+  historyReclaimer(const historyReclaimer& rhs) = delete;
+  historyReclaimer& operator=(const historyReclaimer& rhs) = delete;
+
+  // moving a std::deque in and out of here only steals its chunk map
+  template <typename History>
+  void retire(History history) {
+    auto retired {std::make_shared<History>(std::move(history))};
+    {
+      std::lock_guard<std::mutex> lock {mtx_};
+      retired_.emplace_back(std::move(retired));
+    }
+    cv_.notify_one();
+  }
+
+  // block until all the histories retired so far have been destroyed
+  void waitIdle() {
+    std::unique_lock<std::mutex> lock {mtx_};
+    idle_.wait(lock, [this] () { return retired_.empty() && !busy_; });
+  }
+
+ private:
+  std::mutex mtx_ {};
+  std::condition_variable_any cv_ {};
+  std::condition_variable idle_ {};
+  std::vector<std::shared_ptr<void>> retired_ {};
+  bool busy_ {false};
+  // declared last: the worker must stop before the members it uses are gone
+  std::jthread worker_;
+
+  historyReclaimer() :
+  worker_ ([this] (std::stop_token stoken) { run(stoken); })
+  {}
+
+  void run(std::stop_token stoken) {
+    std::unique_lock<std::mutex> lock {mtx_};
+    while ( true ) {
+      cv_.wait(lock, stoken, [this] () { return !retired_.empty(); });
+      if ( retired_.empty() ) {
+        // stop requested, nothing left to destroy
+        return;
+      }
+      auto batch {std::move(retired_)};
+      retired_.clear();
+      busy_ = true;
+      lock.unlock();
+      // the histories are destroyed here, outside the lock
+      batch.clear();
+      lock.lock();
+      busy_ = false;
+      if ( retired_.empty() ) {
+        idle_.notify_all();
+      }
+    }
+  }
+};  // class historyReclaimer
+
+// retiredHistory
+// the storage of a cleared history, given back according to a reclaimPolicy
+// the retired history is allocated by the first deferred retire only, so that
+// a history never cleared, or cleared with another policy, pays for a pointer
+template <typename History>
+class retiredHistory {
+ public:
+  // number of retired values released by each write in deferred mode
+  static constexpr size_t releaseStride_ {8};
+
+  // takes the storage of history, leaving it empty
+  void retire(History& history, const reclaimPolicy policy) {
+    switch ( policy ) {
+      case reclaimPolicy::immediate:
+        history.clear();
+        break;
+      case reclaimPolicy::deferred:
+        if ( !retired_ ) {
+          retired_ = std::make_unique<History>(std::move(history));
+        }
+        else {
+          if ( !retired_->empty() ) {
+            // a previous history has not been released yet
+            historyReclaimer::instance().retire(std::move(*retired_));
+          }
+          *retired_ = std::move(history);
+        }
+        history.clear();
+        break;
+      case reclaimPolicy::background:
+        historyReclaimer::instance().retire(std::move(history));
+        history.clear();
+        break;
+    }
+  }
+
+  // release some retired values; the freed chunks are then reused by the
+  // allocator for the new values
+  void release() noexcept {
+    if ( !retired_ ) {
+      return;
+    }
+    for (size_t i {0}; (i < releaseStride_) && !retired_->empty(); ++i) {
+      retired_->pop_back();
+    }
+    if ( retired_->empty() ) {
+      retired_.reset();
+    }
+  }
+
+  // evict the oldest values of history down to size values: the work done
+  // is bounded by the smaller of the kept and the evicted values, because
+  // when most values go the kept ones are moved to a new history and the old
+  // storage is retired
+  void trim(History& history, const size_t size, const reclaimPolicy policy) {
+    if ( history.size() <= size ) {
+      return;
+    }
+    const auto evicted {history.size() - size};
+    if ( (reclaimPolicy::immediate == policy) || (evicted <= size) ) {
+      history.erase(history.begin() + static_cast<std::ptrdiff_t>(size), history.end());
+      return;
+    }
+    History kept (std::make_move_iterator(history.begin()),
+                  std::make_move_iterator(history.begin() + static_cast<std::ptrdiff_t>(size)));
+    retire(history, policy);
+    history = std::move(kept);
+  }
+
+  bool empty() const noexcept {
+    return !retired_ || retired_->empty();
+  }
+
+  size_t size() const noexcept {
+    return retired_ ? retired_->size() : 0;
+  }
+
+ private:
+  std::unique_ptr<History> retired_ {};
+};  // class retiredHistory
+
+// The writes kept in the history; the current value is always the last one
+// written, whatever the policy
+enum class sampling {
+  all,          // every write
+  everyNth,     // a write every n
+  timeQuantum,  // the first write of each time quantum, memvarTimed only
+  reservoir     // writes evenly spread over all the writes since sampling started
+};
+
+// drop every other value of history from the one at first, keeping the
+// oldest one
+template <typename History>
+void thinHistory(History& history, const size_t first) {
+  const auto size {history.size()};
+  auto out {history.begin() + static_cast<std::ptrdiff_t>(first)};
+  for (auto i {first}; i < size; ++i) {
+    if ( 0 == ((size - 1 - i) % 2) ) {
+      *out++ = std::move(history[i]);
+    }
+  }
+  history.erase(out, history.end());
+}
+
+// historySampler
+// the state of a sampling policy: the front of the history is the current
+// value, that is provisional when the policy does not keep it, so that the
+// next write overwrites it instead of pushing a new value
+// the reservoir keeps a write every stride writes in historyCapacity - 1
+// values: when they are all taken, every other one is dropped and the stride
+// doubles, so the kept writes stay evenly spread over all the writes, and in
+// the order written; a drop moves the history once, after half of it has
+// been written again, so a write costs amortized O(1)
+class historySampler {
+ public:
+  historySampler(const sampling policy, const uint64_t every, const int64_t quantum) noexcept :
+  policy_ (policy),
+  every_ (every),
+  quantum_ (quantum)
+  {}
+
+  sampling getPolicy() const noexcept {
+    return policy_;
+  }
+
+  bool isFrontKept() const noexcept {
+    return frontKept_;
+  }
+
+  void setFrontKept(const bool frontKept) noexcept {
+    frontKept_ = frontKept;
+  }
+
+  // tell if the quantum of a write at ticks is a new one
+  bool isNewQuantum(const int64_t ticks) noexcept {
+    auto quantum {ticks / quantum_};
+    quantum -= ((ticks % quantum_) < 0);
+    if ( quantum == lastQuantum_ ) {
+      return false;
+    }
+    lastQuantum_ = quantum;
+    return true;
+  }
+
+  // count a write, and tell if it is kept, for sampling::everyNth
+  bool isNth() noexcept {
+    return 0 == (++writes_ % every_);
+  }
+
+  // count a write, and tell if it is kept by the reservoir
+  bool isReservoirSample() noexcept {
+    return (++writes_ - lastKept_) >= stride_;
+  }
+
+  // the full reservoir of the values at [first, size) of the history was
+  // thinned by thinHistory(): returns if the write is still kept with the
+  // doubled stride
+  bool reservoirThinned(const size_t size, const size_t first) noexcept {
+    if ( 0 != ((size - 1 - first) % 2) ) {
+      // the newest kept value was dropped
+      lastKept_ -= stride_;
+    }
+    stride_ *= 2;
+    return (writes_ - lastKept_) >= stride_;
+  }
+
+  void setLastKept() noexcept {
+    lastKept_ = writes_;
+  }
+
+ private:
+  sampling policy_ {sampling::all};
+  uint64_t every_ {1};
+  int64_t quantum_ {1};
+  bool frontKept_ {true};
+  uint64_t writes_ {0};
+  uint64_t lastKept_ {0};
+  uint64_t stride_ {1};
+  int64_t lastQuantum_ {std::numeric_limits<int64_t>::min()};
+};  // class historySampler
+
+// subscriberList
+// the callbacks called after each write to a memvar, by subscription id
+// the callbacks usually capture an observer bound to the address of the
+// memvar, e.g. a memvarRollup or a memvarRangeIndex: the subscriptions stay
+// with that object, a move neither carries them over to the memvar moved to
+// nor replaces the ones it had
+template <typename Callback>
+class subscriberList {
+ public:
+  using subscriptionId = uint64_t;
+
+  subscriberList() = default;
+
+  subscriberList(const subscriberList& rhs) = delete;
+  subscriberList& operator=(const subscriberList& rhs) = delete;
+
+  subscriberList(subscriberList&&) noexcept
+  {}
+
+  subscriberList& operator=(subscriberList&&) noexcept {
+    return *this;
+  }
+
+  subscriptionId add(Callback callback) {
+    subscribers_.emplace_back(++lastId_, std::move(callback));
+    return lastId_;
+  }
+
+  bool remove(const subscriptionId id) {
+    const auto erased {std::erase_if(subscribers_, [id] (const auto& subscriber) { return subscriber.first == id; })};
+    return erased > 0;
+  }
+
+  template <typename... Args>
+  void notify(const Args&... args) const {
+    for (const auto& [id, callback] : subscribers_) {
+      callback(args...);
+    }
+  }
+
+ private:
+  subscriptionId lastId_ {0};
+  std::vector<std::pair<subscriptionId, Callback>> subscribers_ {};
+};  // class subscriberList
+
 class memvarBase {
  public:
   // capacityType: this type must be signed
   using capacityType = int64_t;
+  // sequenceType: the sequence number of a value counts the values written
+  // before it, the initial value has sequence number 0
+  using sequenceType = uint64_t;
+
+  static constexpr capacityType minimumHistoryCapacity_ {2};
+  static constexpr capacityType historyCapacityDefault_ {10};
 
   memvarBase(const memvarBase& rhs) = delete;
   memvarBase& operator=(const memvarBase& rhs) = delete;
-  memvarBase(memvarBase&& rhs) = delete;
-  memvarBase& operator=(memvarBase&& rhs) = delete;
+  memvarBase(memvarBase&& rhs) = default;
+  memvarBase& operator=(memvarBase&& rhs) = default;
 
   capacityType getHistoryCapacity() const noexcept {
     return historyCapacity_;
   }
 
+  reclaimPolicy getReclaimPolicy() const noexcept {
+    return reclaimPolicy_;
+  }
+
+  void setReclaimPolicy(const reclaimPolicy policy) noexcept {
+    reclaimPolicy_ = policy;
+  }
+
  protected:
-  static constexpr capacityType minimumHistoryCapacity_ {2};
-  static constexpr capacityType historyCapacityDefault_ {10};
-  const capacityType historyCapacity_ {historyCapacityDefault_};
+  capacityType historyCapacity_ {historyCapacityDefault_};
+  reclaimPolicy reclaimPolicy_ {reclaimPolicy::deferred};
 
   explicit memvarBase(capacityType historyCapacity) noexcept :
   historyCapacity_ (historyCapacity)
   {}
 
+  static void checkHistoryCapacity(const capacityType historyCapacity) {
+    if ( historyCapacity < minimumHistoryCapacity_ ) {
+      throw std::invalid_argument("ERROR: The history capacity must be " + std::to_string(minimumHistoryCapacity_) + " at least, or more");
+    }
+  }
+
   memvarBase() = default;
   virtual ~memvarBase() = default;
 };  // memvarBase
@@ -104,10 +435,61 @@ class memvarBase {
 // only strings, integral or floating point types allowed
 template <typename T>
 class memvar : public memvarBase {
+ public:
+  // called with the new value and its sequence number after each write
+  using changeCallback = std::function<void(const T& value, sequenceType sequence)>;
+  using subscriptionId = typename subscriberList<changeCallback>::subscriptionId;
+  // the running sum of the values written: an integral sum wraps around
+  using sumType = std::conditional_t<std::is_same_v<T, long double>, long double,
+                  std::conditional_t<std::is_floating_point_v<T>, double,
+                  std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>>;
+
+  // the statistics of all the values written, the initial one included,
+  // evicted from the history or not
+  struct lifetimeStats {
+    sequenceType writes_ {0};     // the writes after the initial value
+    sequenceType unchanged_ {0};  // the writes not recorded in change only mode
+    sequenceType evictions_ {0};  // the values written no longer in the history
+    T min_ {};
+    sequenceType minSequence_ {0};
+    T max_ {};
+    sequenceType maxSequence_ {0};
+    sumType sum_ {};
+  };
+
  protected:
   using memvarHistory = std::deque<T>;
 
   memvarHistory memo_ {};
+  retiredHistory<memvarHistory> retiredMemo_ {};
+  sequenceType sequence_ {0};
+  subscriberList<changeCallback> subscribers_ {};
+  bool changeOnly_ {false};
+  double changeEpsilon_ {0.0};
+  sequenceType unchangedCount_ {0};
+  std::unique_ptr<historySampler> sampler_ {};
+
+  // the lifetime min, max and sum, of integral and floating point values
+  struct extrema {
+    T min_ {};
+    sequenceType minSequence_ {0};
+    T max_ {};
+    sequenceType maxSequence_ {0};
+    sumType sum_ {};
+  };
+  struct noExtrema {};
+  [[no_unique_address]] std::conditional_t<std::is_arithmetic_v<T>, extrema, noExtrema> extrema_ {};
+
+  // how a write changed the history, so that a history kept along with it
+  // is changed the same way
+  struct recordedWrite {
+    // the value was pushed, or it overwrote the provisional current value
+    bool pushed_ {true};
+    // thinHistory() dropped every other value from the one at thinnedFrom_
+    // before the write, for sampling::reservoir
+    bool thinned_ {false};
+    size_t thinnedFrom_ {0};
+  };
 
 	static void checkType() {
 		static_assert((std::is_integral_v<T> != false ||
@@ -121,13 +503,141 @@ class memvar : public memvarBase {
     return memo_.at(0);
   }
 
-  virtual void setValue(const T& value) {
+  // write value to the history as the sampling policy says, without calling
+  // the subscribers; newQuantum tells if the write is the first of its time
+  // quantum for sampling::timeQuantum
+  recordedWrite recordValue(const T& value, const bool newQuantum = true) {
+    if ( !retiredMemo_.empty() ) {
+      retiredMemo_.release();
+    }
+    recordedWrite write {};
+    if ( !sampler_ || memo_.empty() ) {
+      pushValue(value);
+      if ( sampler_ ) {
+        sampler_->setFrontKept(true);
+      }
+      return write;
+    }
+    auto& sampler {*sampler_};
+    bool keep {true};
+    switch ( sampler.getPolicy() ) {
+      case sampling::all:
+        break;
+      case sampling::everyNth:
+        keep = sampler.isNth();
+        break;
+      case sampling::timeQuantum:
+        keep = newQuantum;
+        break;
+      case sampling::reservoir: {
+        keep = sampler.isReservoirSample();
+        const size_t first {sampler.isFrontKept() ? 0U : 1U};
+        if ( keep && (static_cast<capacityType>(memo_.size() - first) >= historyCapacity_ - 1) ) {
+          write.thinned_ = true;
+          write.thinnedFrom_ = first;
+          const auto size {memo_.size()};
+          thinHistory(memo_, first);
+          keep = sampler.reservoirThinned(size, first);
+        }
+        if ( keep ) {
+          sampler.setLastKept();
+        }
+        break;
+      }
+    }
+    if ( sampler.isFrontKept() ) {
+      pushValue(value);
+    }
+    else {
+      memo_.front() = value;
+      write.pushed_ = false;
+    }
+    sampler.setFrontKept(keep);
+    return write;
+  }
+
+  void pushValue(const T& value) {
     memo_.emplace_front(value);
     if ( static_cast<capacityType>(memo_.size()) > historyCapacity_ ) {
       memo_.pop_back();
     }
   }
 
+  // in change only mode, true when value equals the current value: the write
+  // is not recorded
+  bool isUnchanged(const T& value) noexcept {
+    if ( !changeOnly_ || memo_.empty() ) {
+      return false;
+    }
+    bool unchanged {value == memo_.front()};
+    if constexpr ( std::is_floating_point_v<T> ) {
+      unchanged = unchanged || (std::abs(value - memo_.front()) <= changeEpsilon_);
+    }
+    unchangedCount_ += unchanged;
+    return unchanged;
+  }
+
+  void startSampling(const sampling policy, const uint64_t every, const int64_t quantum) {
+    if ( sampling::all == policy ) {
+      sampler_.reset();
+      return;
+    }
+    sampler_ = std::make_unique<historySampler>(policy, every, quantum);
+  }
+
+  virtual void setValue(const T& value) {
+    if ( isUnchanged(value) ) {
+      return;
+    }
+    recordValue(value);
+    updateExtrema(value, sequence_ + 1);
+    notifyChange(1);
+  }
+
+  // count values were appended, the newest written of them are in the history
+  virtual void valuesAppended(const capacityType count, [[maybe_unused]] const capacityType written) {
+    // each value appended counts as a write, but the subscribers are called
+    // once, with the newest value
+    notifyChange(static_cast<sequenceType>(count));
+  }
+
+  void initExtrema() noexcept {
+    if constexpr ( std::is_arithmetic_v<T> ) {
+      extrema_ = {memo_.front(), 0, memo_.front(), 0, static_cast<sumType>(memo_.front())};
+    }
+  }
+
+  // count the value with sequence number sequence in the lifetime statistics
+  void updateExtrema([[maybe_unused]] const T& value, [[maybe_unused]] const sequenceType sequence) noexcept {
+    if constexpr ( std::is_arithmetic_v<T> ) {
+      if ( value < extrema_.min_ ) {
+        extrema_.min_ = value;
+        extrema_.minSequence_ = sequence;
+      }
+      if ( value > extrema_.max_ ) {
+        extrema_.max_ = value;
+        extrema_.maxSequence_ = sequence;
+      }
+      if constexpr ( std::is_integral_v<T> ) {
+        extrema_.sum_ = static_cast<sumType>(static_cast<uint64_t>(extrema_.sum_) + static_cast<uint64_t>(value));
+      }
+      else {
+        extrema_.sum_ += value;
+      }
+    }
+  }
+
+  // a write of count values
+  void notifyChange(const sequenceType count) {
+    sequence_ += count;
+    subscribers_.notify(memo_.front(), sequence_);
+  }
+
+  // evict the oldest values of the history down to size values
+  virtual void trimHistory(const size_t size) {
+    retiredMemo_.trim(memo_, size, reclaimPolicy_);
+  }
+
   T incr1() requires (!AnyStandardString<T>) {
     const T newValue {static_cast<T>(getValue() + 1)};
 
@@ -158,18 +668,24 @@ class memvar : public memvarBase {
       return;
     }
 
-    auto printItem = [&separator, &os] (const T& item) -> void {
-      os << item << separator;
+    textWriter out {os, textWriter::streamFormat {}};
+    bool first {true};
+    auto printItem = [&separator, &out, &first] (const T& item) -> void {
+      if ( !first ) {
+        out.write(separator);
+      }
+      out.writeValue(item);
+      first = false;
     };
 
-    os << "[ ";
+    out.write("[ ");
     if ( printReverse ) {
       std::for_each(history.crbegin(), history.crend(), printItem);
     }
     else {
       std::for_each(history.cbegin(), history.cend(), printItem);
     }
-    os << "\b \b ]\n";
+    out.write(" ]\n");
   }
 
  public:
@@ -179,23 +695,29 @@ class memvar : public memvarBase {
   memvarBase() {
     checkType();
     memo_.emplace_front(T{});
+    initExtrema();
   }
 
   explicit memvar(const T& value,
                   const capacityType historyCapacity = historyCapacityDefault_) :
   memvarBase(historyCapacity) {
     checkType();
-    if ( historyCapacity_ < minimumHistoryCapacity_ ) {
-      throw std::invalid_argument("ERROR: The history capacity must be " + std::to_string(minimumHistoryCapacity_) + " at least, or more");
-    }
+    checkHistoryCapacity(historyCapacity_);
     memo_.emplace_front(value);
+    initExtrema();
   }
 
   virtual ~memvar() = default;
 
   memvar(const memvar& rhs) = delete;
-  memvar(memvar&& rhs) = delete;
-  memvar& operator=(memvar&& rhs) = delete;
+  // moving steals the history storage, so memvars can be kept by value in
+  // containers like std::vector; a moved-from memvar has an empty history
+  // and can only be assigned to by move, or destroyed
+  // the subscriptions are not moved: the memvar moved to keeps its own, none
+  // if it is constructed, and the observers of the one moved from must be
+  // destroyed or unsubscribed before it is
+  memvar(memvar&& rhs) = default;
+  memvar& operator=(memvar&& rhs) = default;
 
   // conversion operator from memvar::memvar<T> to T
   operator T() const {
@@ -293,9 +815,118 @@ class memvar : public memvarBase {
     return static_cast<capacityType>(memo_.size());
   }
 
+  // O(1) unless the reclaim policy is reclaimPolicy::immediate: the storage
+  // of the history is handed over to the reclaim policy, by default deferred
+  // the history starts over with the 'zero' value: it takes a sequence
+  // number, so that the values in the history keep theirs and the cleared
+  // values count as evicted, but it is not a value written: the lifetime
+  // min, max and sum leave it out, and the subscribers are not called
   virtual void clearHistory() {
-    memo_.clear();
-    setValue(T{});
+    retiredMemo_.retire(memo_, reclaimPolicy_);
+    recordValue(T{});
+    ++sequence_;
+  }
+
+  // number of values of cleared histories not released yet
+  size_t getRetiredHistorySize() const noexcept {
+    return retiredMemo_.size();
+  }
+
+  // change the history capacity keeping the history: growing is O(1), and
+  // shrinking evicts the oldest values that do not fit the new capacity
+  void setHistoryCapacity(const capacityType historyCapacity) {
+    checkHistoryCapacity(historyCapacity);
+    if ( historyCapacity < static_cast<capacityType>(memo_.size()) ) {
+      trimHistory(static_cast<size_t>(historyCapacity));
+    }
+    historyCapacity_ = historyCapacity;
+  }
+
+  // in change only mode the writes of a value equal to the current one are
+  // not recorded: the history, the sequence number and the subscribers are
+  // left as they are, so the history keeps more changes for the same capacity
+  // the bulk appends are recorded as they are
+  void setChangeOnly(const bool changeOnly) noexcept {
+    changeOnly_ = changeOnly;
+  }
+
+  bool isChangeOnly() const noexcept {
+    return changeOnly_;
+  }
+
+  // floating point values within epsilon of the current value are equal to it
+  void setChangeEpsilon(const T epsilon) requires std::floating_point<T> {
+    if ( !(epsilon >= 0) ) {
+      throw std::invalid_argument("ERROR: The change epsilon must be 0 or greater");
+    }
+    changeEpsilon_ = static_cast<double>(epsilon);
+  }
+
+  T getChangeEpsilon() const noexcept requires std::floating_point<T> {
+    return static_cast<T>(changeEpsilon_);
+  }
+
+  // number of writes not recorded in change only mode
+  sequenceType getUnchangedCount() const noexcept {
+    return unchangedCount_;
+  }
+
+  // number of writes after the initial value, the values of the bulk
+  // appends included
+  sequenceType getWriteCount() const noexcept {
+    return sequence_;
+  }
+
+  // number of values written no longer in the history: pushed out by the
+  // capacity, overwritten by sampling, expired, or cleared
+  sequenceType getEvictionCount() const noexcept {
+    return sequence_ + 1 - static_cast<sequenceType>(memo_.size());
+  }
+
+  // O(1): the lifetime statistics are kept up to date by the writes
+  lifetimeStats getLifetimeStats() const noexcept requires std::is_arithmetic_v<T> {
+    return {getWriteCount(), unchangedCount_, getEvictionCount(),
+            extrema_.min_, extrema_.minSequence_, extrema_.max_, extrema_.maxSequence_, extrema_.sum_};
+  }
+
+  void printLifetimeStats(std::ostream& os = std::cout) const requires std::is_arithmetic_v<T> {
+    const auto stats {getLifetimeStats()};
+    textWriter out {os, textWriter::streamFormat {}};
+    out.write("{ writes: ");
+    out.writeValue(stats.writes_);
+    out.write(", unchanged: ");
+    out.writeValue(stats.unchanged_);
+    out.write(", evictions: ");
+    out.writeValue(stats.evictions_);
+    out.write(", min: ");
+    out.writeValue(stats.min_);
+    out.write(" #");
+    out.writeValue(stats.minSequence_);
+    out.write(", max: ");
+    out.writeValue(stats.max_);
+    out.write(" #");
+    out.writeValue(stats.maxSequence_);
+    out.write(", sum: ");
+    out.writeValue(stats.sum_);
+    out.write(" }\n");
+  }
+
+  // keep a sample of the writes in the history, for sampling::everyNth a
+  // write every n; the history is kept as it is, the sampling starts with
+  // the next write
+  // the bulk appends are recorded as they are
+  void setSampling(const sampling policy, const uint64_t every = 1) {
+    if ( sampling::timeQuantum == policy ) {
+      throw std::invalid_argument("ERROR: Time quantum sampling requires a memvarTimed");
+    }
+    if ( (sampling::everyNth == policy) && (0 == every) ) {
+      throw std::invalid_argument("ERROR: Every nth sampling requires n greater than 0");
+    }
+    startSampling(policy, every, 1);
+  }
+
+  sampling getSampling() const noexcept {
+    return sampler_ ? sampler_->getPolicy() : sampling::all;
   }
 
   auto isHistoryFull() const noexcept {
@@ -306,6 +937,79 @@ class memvar : public memvarBase {
     return memo_;
   }
 
+  // the sequence number of the current value
+  sequenceType getSequence() const noexcept {
+    return sequence_;
+  }
+
+  // register a callback called after each write; the callbacks run on the
+  // writing thread and must not subscribe or unsubscribe
+  subscriptionId onChange(changeCallback callback) {
+    return subscribers_.add(std::move(callback));
+  }
+
+  bool unsubscribe(const subscriptionId id) {
+    return subscribers_.remove(id);
+  }
+
+  // bulk append: the values in [first, last) are in chronological order, so
+  // *first is the oldest one and *(last - 1) becomes the current value;
+  // only the values that survive the history capacity are written, and the
+  // old values they push out are evicted in one go
+  // returns the number of values written to the history
+  template <std::bidirectional_iterator It>
+    requires std::convertible_to<std::iter_reference_t<It>, T>
+  capacityType append(It first, It last) {
+    const auto count {static_cast<capacityType>(std::distance(first, last))};
+    if ( count <= 0 ) {
+      return 0;
+    }
+    const auto written {std::min(count, historyCapacity_)};
+    if constexpr ( std::is_arithmetic_v<T> ) {
+      auto sequence {sequence_};
+      for (auto it {first}; it != last; ++it) {
+        updateExtrema(*it, ++sequence);
+      }
+    }
+    std::advance(first, count - written);
+
+    const auto overflow {static_cast<capacityType>(memo_.size()) + written - historyCapacity_};
+    if ( overflow > 0 ) {
+      memo_.erase(memo_.end() - overflow, memo_.end());
+    }
+    memo_.insert(memo_.begin(), std::make_reverse_iterator(last), std::make_reverse_iterator(first));
+    if ( sampler_ ) {
+      sampler_->setFrontKept(true);
+    }
+    valuesAppended(count, written);
+    return written;
+  }
+
+  capacityType append(std::span<const T> values) {
+    return append(values.begin(), values.end());
+  }
+
+  // copy the n newest values of the history to out, in the given order
+  // returns the number of values copied: n is capped by the history size
+  // and by the size of out
+  capacityType copyHistoryTo(std::span<T> out,
+                             capacityType n,
+                             const historyOrder order = historyOrder::newestFirst) const {
+    n = std::min({n,
+                  static_cast<capacityType>(memo_.size()),
+                  static_cast<capacityType>(out.size())});
+    if ( n <= 0 ) {
+      return 0;
+    }
+    // for trivially copyable T, copying from deque iterators to a pointer is
+    // done with one memmove per deque chunk
+    std::copy_n(memo_.cbegin(), n, out.begin());
+    if ( historyOrder::oldestFirst == order ) {
+      std::reverse(out.begin(), out.begin() + n);
+    }
+    return n;
+  }
+
   auto getHistoryValue(const capacityType index) const noexcept -> historyValue {
     if ( (index < static_cast<capacityType>(memo_.size())) && (index >= 0) ) {
       return std::make_tuple(memo_.at(static_cast<size_t>(index)), false);
@@ -481,6 +1185,7 @@ template <typename T,
 class memvarTimed final : public memvar<T> {
  public:
   using historyTimedValue = std::tuple<T, Time, bool>;
+  using timePoint = std::chrono::time_point<Clock, Time>;
 
   memvarTimed() :
   memvar<T>() {
@@ -500,8 +1205,10 @@ class memvarTimed final : public memvar<T> {
   }
 
   memvarTimed(const memvarTimed& rhs) = delete;
-  memvarTimed(memvarTimed&& rhs) = delete;
-  memvarTimed& operator=(memvarTimed&& rhs) = delete;
+  // moving steals the value and time tag histories, and the time point epoch,
+  // not the subscriptions, as for a memvar
+  memvarTimed(memvarTimed&& rhs) = default;
+  memvarTimed& operator=(memvarTimed&& rhs) = default;
 
   // conversion operator from memvar::memvarTimed<T> to T
   operator T() const {
@@ -519,6 +1226,64 @@ class memvarTimed final : public memvar<T> {
     setValue(rhs);
     return *this;
   }
+
+  // store a value with a time point taken elsewhere, e.g. by the thread that
+  // produced the value
+  void setValueAt(const T& value, const timePoint& when) {
+    if ( memvar<T>::isUnchanged(value) ) {
+      confirmed_ = std::max(confirmed_, when);
+      return;
+    }
+    recordValueAt(value, when);
+    memvar<T>::updateExtrema(value, memvar<T>::sequence_ + 1);
+    memvar<T>::notifyChange(1);
+  }
+
+  // keep only the values written within retention of the newest one, on top
+  // of the history capacity, that stays the hard cap of the history size,
+  // so a burst cannot grow the history past it
+  // a retention of 0 keeps the values as long as they fit the capacity
+  void setRetention(const Time retention) {
+    if ( retention < Time::zero() ) {
+      throw std::invalid_argument("ERROR: The retention must be 0 or greater");
+    }
+    retention_ = retention;
+    expireHistory(timeMemo_.front());
+  }
+
+  Time getRetention() const noexcept {
+    return retention_;
+  }
+
+  using memvar<T>::setSampling;
+
+  // keep the first write of each time quantum in the history, the quanta
+  // aligned on the epoch of the clock
+  void setSampling(const Time quantum) {
+    if ( quantum <= Time::zero() ) {
+      throw std::invalid_argument("ERROR: The sampling time quantum must be greater than 0");
+    }
+    memvar<T>::startSampling(sampling::timeQuantum, 1, quantum.count());
+  }
+
+  // evict the values older than now - retention, the current value excepted:
+  // the writes do it on their own, this is for a history that is read while
+  // no more values are written
+  // each value is evicted once, so the eviction is amortized O(1) per write
+  void expireHistory(const timePoint& now = Clock::now()) {
+    if ( retention_ <= Time::zero() ) {
+      return;
+    }
+    auto& memo {memvar<T>::memo_};
+    const auto horizon {now - retention_};
+    // the value and time histories are the same size but while a write or a
+    // clear is in progress: stop at the current value of either one
+    while ( (timeMemo_.size() > 1) && (memo.size() > 1) && (timeMemo_.back() < horizon) ) {
+      timeMemo_.pop_back();
+      memo.pop_back();
+    }
+  }
+
   memvarTimed& operator=(const memvarTimed& rhs) {
     setValue(rhs.getValue());
     return *this;
@@ -566,45 +1331,42 @@ class memvarTimed final : public memvar<T> {
     return std::chrono::duration_cast<Time>(timeMemo_.at(index) - memvarEpoch_);
   }
 
+  // the time point when the i-th value in the history was written
+  timePoint getTimePoint(const size_t index = 0) const {
+    return timeMemo_.at(index);
+  }
+
+  // the time point of the last write of the current value: in change only
+  // mode, the one of the last write not recorded because unchanged
+  timePoint getLastConfirmed() const {
+    return std::max(confirmed_, timeMemo_.at(0));
+  }
+
+  // the time points of the history, from newest to oldest value
+  const auto& getTimeHistory() const noexcept {
+    return timeMemo_;
+  }
+
   void printHistoryTimedData(std::ostream& os = std::cout, const std::string& separator = std::string("\n")) const {
-    if ( 0 == memvar<T>::memo_.size() ) {
-      return;
-    }
-    os << "{ --- begin ---\n[TimeTag:Value]\n";
-    for (size_t i {0}; i < memvar<T>::memo_.size(); ++i) {
-      os << "["
-         << getTimeTag(i).count()
-         << ":"
-         << memvar<T>::memo_.at(i) << "]"
-         << separator;
-    }
-    os << "  --- end --- }\n\n";
+    timedPrinter(os, false, separator);
   }
   void printReverseHistoryTimedData(std::ostream& os = std::cout, const std::string& separator = std::string("\n")) const {
-    if ( 0 == memvar<T>::memo_.size() ) {
-      return;
-    }
-    os << "{ --- begin ---\n[TimeTag:Value]\n";
-    for (auto i {static_cast<memvarBase::capacityType>(memvar<T>::memo_.size() - 1)}; i >= 0; --i) {
-      os << "["
-         << getTimeTag(static_cast<size_t>(i)).count()
-         << ":"
-         << memvar<T>::memo_.at(static_cast<size_t>(i)) << "]"
-         << separator;
-    }
-    os << "  --- end --- }\n\n";
+    timedPrinter(os, true, separator);
   }
 
   void clearHistory() override {
-    // clear the memvar's history
-    memvar<T>::clearHistory();
-    // store the time point epoch for the memvar
-    memvarEpoch_ = Clock::now();
     // clearing the timed memvar means also to reset the time point epoch
     // associated to the first 'zero' value
-    // store the time point for the first value
-    timeMemo_.clear();
-    timeMemo_.emplace_front(memvarEpoch_);
+    memvarEpoch_ = Clock::now();
+    confirmed_ = {};
+    // retire both histories before the first value is written, so that the
+    // write, the retention and the subscribers see them empty together
+    memvar<T>::retiredMemo_.retire(memvar<T>::memo_, memvarBase::reclaimPolicy_);
+    retiredTimeMemo_.retire(timeMemo_, memvarBase::reclaimPolicy_);
+    // store the time point epoch for the first value, that is not a write
+    // as in memvar<T>::clearHistory()
+    recordValueAt(T{}, memvarEpoch_);
+    ++memvar<T>::sequence_;
   }
 
   auto getHistoryValue(const memvarBase::capacityType index) const noexcept -> historyTimedValue const {
@@ -617,18 +1379,87 @@ class memvarTimed final : public memvar<T> {
   }
 
  private:
-  using memvarTimeHistory = std::deque<std::chrono::time_point<Clock, Time>>;
+  using memvarTimeHistory = std::deque<timePoint>;
 
   memvarTimeHistory timeMemo_ {};
-  std::chrono::time_point<Clock, Time> memvarEpoch_ {};
+  retiredHistory<memvarTimeHistory> retiredTimeMemo_ {};
+  timePoint memvarEpoch_ {};
+  Time retention_ {Time::zero()};
+  timePoint confirmed_ {};
+
+  void timedPrinter(std::ostream& os, const bool printReverse, const std::string& separator) const {
+    const auto& memo {memvar<T>::memo_};
+    if ( memo.empty() ) {
+      return;
+    }
+    textWriter out {os, textWriter::streamFormat {}};
+    auto printItem = [this, &out, &memo, &separator] (const size_t i) -> void {
+      out.put('[');
+      out.writeValue(std::chrono::duration_cast<Time>(timeMemo_[i] - memvarEpoch_).count());
+      out.put(':');
+      out.writeValue(memo[i]);
+      out.put(']');
+      out.write(separator);
+    };
 
-  void setTimeTag() {
-    timeMemo_.emplace_front(Clock::now());
+    out.write("{ --- begin ---\n[TimeTag:Value]\n");
+    if ( printReverse ) {
+      for (auto i {memo.size()}; i > 0; --i) {
+        printItem(i - 1);
+      }
+    }
+    else {
+      for (size_t i {0}; i < memo.size(); ++i) {
+        printItem(i);
+      }
+    }
+    out.write("  --- end --- }\n\n");
+  }
+
+  // write value to both histories as the sampling policy says, without
+  // counting it in the lifetime statistics or calling the subscribers
+  void recordValueAt(const T& value, const timePoint& when) {
+    const auto& sampler {memvar<T>::sampler_};
+    const bool newQuantum {!sampler || (sampling::timeQuantum != sampler->getPolicy()) ||
+                           sampler->isNewQuantum(when.time_since_epoch().count())};
+    const auto write {memvar<T>::recordValue(value, newQuantum)};
+    if ( write.thinned_ ) {
+      thinHistory(timeMemo_, write.thinnedFrom_);
+    }
+    if ( write.pushed_ ) {
+      setTimeTag(when);
+    }
+    else {
+      timeMemo_.front() = when;
+    }
+    if ( timeMemo_.size() > memvar<T>::memo_.size() ) {
+      timeMemo_.pop_back();
+    }
+    expireHistory(when);
+  }
+
+  void setTimeTag(const timePoint& when) {
+    if ( !retiredTimeMemo_.empty() ) {
+      retiredTimeMemo_.release();
+    }
+    timeMemo_.emplace_front(when);
   }
 
   void setValue(const T& value) override {
-    setTimeTag();
-    memvar<T>::setValue(value);
+    setValueAt(value, Clock::now());
+  }
+
+  // all the values of a bulk append share the same time tag
+  void valuesAppended(const memvarBase::capacityType count, const memvarBase::capacityType written) override {
+    timeMemo_.insert(timeMemo_.begin(), static_cast<size_t>(written), Clock::now());
+    timeMemo_.resize(memvar<T>::memo_.size());
+    expireHistory(timeMemo_.front());
+    memvar<T>::valuesAppended(count, written);
+  }
+
+  void trimHistory(const size_t size) override {
+    memvar<T>::trimHistory(size);
+    retiredTimeMemo_.trim(timeMemo_, size, memvarBase::reclaimPolicy_);
   }
 };  // class memvarTimed
 
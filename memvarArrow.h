@@ -0,0 +1,750 @@
+//
+// memvarArrow.h
+//
+#pragma once
+
+#include "memvar.h"
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+namespace detail
+{
+static_assert(std::endian::native == std::endian::little, "Little endian hosts required by the arrow writer.");
+
+// flatbufferBuilder
+// the few parts of a flatbuffers builder needed to write the arrow metadata:
+// the buffer is built from its end, so that an object is written before the
+// objects referring to it, and each object is referred to by its distance
+// from the end of the buffer
+class flatbufferBuilder {
+ public:
+  using ref = uint32_t;
+
+  flatbufferBuilder() :
+  buffer_ (1024),
+  head_ (buffer_.size())
+  {}
+
+  ref size() const noexcept {
+    return static_cast<ref>(buffer_.size() - head_);
+  }
+
+  ref createString(const std::string_view text) {
+    preAlign(text.size() + 1, sizeof(uint32_t));
+    prependScalar<uint8_t>(0);
+    prependBytes(text.data(), text.size());
+    prependScalar(static_cast<uint32_t>(text.size()));
+    return size();
+  }
+
+  // a vector of scalars or of structs
+  template <typename T>
+  ref createVector(const std::span<const T> values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    preAlign(values.size_bytes(), std::max(alignof(T), sizeof(uint32_t)));
+    prependBytes(values.data(), values.size_bytes());
+    prependScalar(static_cast<uint32_t>(values.size()));
+    return size();
+  }
+
+  // a vector of strings or tables
+  ref createOffsetVector(const std::span<const ref> objects) {
+    preAlign(objects.size() * sizeof(uint32_t), sizeof(uint32_t));
+    for (auto it {objects.rbegin()}; it != objects.rend(); ++it) {
+      prependOffset(*it);
+    }
+    prependScalar(static_cast<uint32_t>(objects.size()));
+    return size();
+  }
+
+  // the fields of a table are added between startTable() and endTable(),
+  // after the objects they refer to: tables cannot be nested
+  void startTable() {
+    fields_.clear();
+    tableEnd_ = size();
+  }
+
+  template <typename T>
+  void addScalar(const uint16_t id, const T value) {
+    align(sizeof(T));
+    prependScalar(value);
+    fields_.emplace_back(id, size());
+  }
+
+  void addOffset(const uint16_t id, const ref object) {
+    prependOffset(object);
+    fields_.emplace_back(id, size());
+  }
+
+  ref endTable() {
+    align(sizeof(int32_t));
+    prependScalar<int32_t>(0);
+    const ref table {size()};
+    uint16_t slots {0};
+    for (const auto& [id, field] : fields_) {
+      slots = std::max<uint16_t>(slots, id + 1);
+    }
+    std::vector<uint16_t> vtable (2 + slots, 0);
+    vtable[0] = static_cast<uint16_t>(vtable.size() * sizeof(uint16_t));
+    vtable[1] = static_cast<uint16_t>(table - tableEnd_);
+    for (const auto& [id, field] : fields_) {
+      vtable[2 + id] = static_cast<uint16_t>(table - field);
+    }
+    for (auto it {vtable.rbegin()}; it != vtable.rend(); ++it) {
+      prependScalar(*it);
+    }
+    // the table starts with the distance back to its vtable
+    const auto vtableDistance {static_cast<int32_t>(size() - table)};
+    std::memcpy(buffer_.data() + buffer_.size() - table, &vtableDistance, sizeof(vtableDistance));
+    return table;
+  }
+
+  // the buffer, starting with the offset of its root table; its size is a
+  // multiple of 8
+  std::span<const char> finish(const ref root) {
+    preAlign(sizeof(uint32_t), minimumAlignment_);
+    prependOffset(root);
+    return {reinterpret_cast<const char*>(buffer_.data()) + head_, size()};
+  }
+
+ private:
+  std::vector<uint8_t> buffer_;
+  size_t head_;
+  size_t minimumAlignment_ {sizeof(uint64_t)};
+  std::vector<std::pair<uint16_t, ref>> fields_ {};
+  ref tableEnd_ {0};
+
+  void reserve(const size_t size) {
+    if ( head_ < size ) {
+      const auto used {buffer_.size() - head_};
+      std::vector<uint8_t> buffer (std::max(2 * buffer_.size(), used + size));
+      std::memcpy(buffer.data() + buffer.size() - used, buffer_.data() + head_, used);
+      head_ = buffer.size() - used;
+      buffer_ = std::move(buffer);
+    }
+  }
+
+  void prependBytes(const void* data, const size_t size) {
+    reserve(size);
+    head_ -= size;
+    if ( size > 0 ) {
+      std::memcpy(buffer_.data() + head_, data, size);
+    }
+  }
+
+  template <typename T>
+  void prependScalar(const T value) {
+    prependBytes(&value, sizeof(value));
+  }
+
+  void prependOffset(const ref object) {
+    align(sizeof(uint32_t));
+    prependScalar(static_cast<uint32_t>(size() + sizeof(uint32_t) - object));
+  }
+
+  // pad so that size bytes prepended next end at a multiple of alignment
+  void preAlign(const size_t size, const size_t alignment) {
+    minimumAlignment_ = std::max(minimumAlignment_, alignment);
+    while ( 0 != (this->size() + size) % alignment ) {
+      prependScalar<uint8_t>(0);
+    }
+  }
+
+  void align(const size_t alignment) {
+    preAlign(0, alignment);
+  }
+};  // class flatbufferBuilder
+
+// the parts of the arrow format written here, from the flatbuffers schemas
+// of the arrow columnar format, version 5 of the metadata
+namespace arrow
+{
+inline constexpr char magic[] {"ARROW1"};
+inline constexpr size_t magicSize {6};
+// the leading magic, padded to 8 bytes
+inline constexpr char paddedMagic[8] {'A', 'R', 'R', 'O', 'W', '1', '\0', '\0'};
+inline constexpr uint32_t continuation {0xffffffff};
+inline constexpr int16_t metadataV5 {4};
+// the buffers in the body of a message are aligned as recommended
+inline constexpr int64_t bufferAlignment {64};
+
+enum messageHeader : uint8_t {
+  schema = 1,
+  recordBatch = 3
+};
+
+enum typeId : uint8_t {
+  intType = 2,
+  floatingPointType = 3,
+  boolType = 6,
+  timestampType = 10,
+  durationType = 18,
+  largeUtf8Type = 20
+};
+
+enum timeUnit : int16_t {
+  second,
+  millisecond,
+  microsecond,
+  nanosecond
+};
+
+struct fieldNode {
+  int64_t length_;
+  int64_t nullCount_;
+};
+
+struct buffer {
+  int64_t offset_;
+  int64_t length_;
+};
+
+struct block {
+  int64_t offset_;
+  int32_t metaDataLength_;
+  int32_t padding_;
+  int64_t bodyLength_;
+};
+
+struct type {
+  typeId id_ {intType};
+  int32_t bitWidth_ {0};
+  bool isSigned_ {false};
+  int16_t precision_ {0};
+  timeUnit unit_ {nanosecond};
+  std::string timezone_ {};
+};
+
+inline constexpr int64_t alignBuffer(const int64_t size) noexcept {
+  return (size + bufferAlignment - 1) / bufferAlignment * bufferAlignment;
+}
+
+// the type table, of the Type union
+inline flatbufferBuilder::ref createType(flatbufferBuilder& fbb, const type& t) {
+  flatbufferBuilder::ref timezone {0};
+  if ( !t.timezone_.empty() ) {
+    timezone = fbb.createString(t.timezone_);
+  }
+  fbb.startTable();
+  switch ( t.id_ ) {
+    case intType:
+      fbb.addScalar<int32_t>(0, t.bitWidth_);
+      fbb.addScalar<uint8_t>(1, t.isSigned_);
+      break;
+    case floatingPointType:
+      fbb.addScalar<int16_t>(0, t.precision_);
+      break;
+    case timestampType:
+      if ( 0 != timezone ) {
+        fbb.addOffset(1, timezone);
+      }
+      fbb.addScalar<int16_t>(0, t.unit_);
+      break;
+    case durationType:
+      fbb.addScalar<int16_t>(0, t.unit_);
+      break;
+    case boolType:
+    case largeUtf8Type:
+      break;
+  }
+  return fbb.endTable();
+}
+
+struct keyValue {
+  std::string key_;
+  std::string value_;
+};
+
+inline flatbufferBuilder::ref createField(flatbufferBuilder& fbb,
+                                          const std::string& name,
+                                          const type& t,
+                                          const std::vector<keyValue>& metadata) {
+  const auto nameRef {fbb.createString(name)};
+  const auto typeRef {createType(fbb, t)};
+  const auto children {fbb.createOffsetVector({})};
+  std::vector<flatbufferBuilder::ref> pairs {};
+  for (const auto& [key, value] : metadata) {
+    const auto keyRef {fbb.createString(key)};
+    const auto valueRef {fbb.createString(value)};
+    fbb.startTable();
+    fbb.addOffset(0, keyRef);
+    fbb.addOffset(1, valueRef);
+    pairs.push_back(fbb.endTable());
+  }
+  const auto metadataRef {metadata.empty() ? 0 : fbb.createOffsetVector(pairs)};
+  fbb.startTable();
+  fbb.addOffset(0, nameRef);
+  fbb.addOffset(3, typeRef);
+  fbb.addOffset(5, children);
+  if ( 0 != metadataRef ) {
+    fbb.addOffset(6, metadataRef);
+  }
+  fbb.addScalar<uint8_t>(1, 1);
+  fbb.addScalar<uint8_t>(2, t.id_);
+  return fbb.endTable();
+}
+
+// write the metadata of a message, padded so that the body that follows
+// starts at a multiple of bufferAlignment in the file
+inline block writeMessage(std::ostream& os,
+                          int64_t& fileOffset,
+                          const std::span<const char> metadata,
+                          const int64_t bodyLength) {
+  const int64_t start {fileOffset};
+  const auto padded {alignBuffer(start + 8 + static_cast<int64_t>(metadata.size())) - start - 8};
+  const auto metadataLength {static_cast<int32_t>(padded)};
+  static constexpr char zeros[bufferAlignment] {};
+  os.write(reinterpret_cast<const char*>(&continuation), sizeof(continuation));
+  os.write(reinterpret_cast<const char*>(&metadataLength), sizeof(metadataLength));
+  os.write(metadata.data(), static_cast<std::streamsize>(metadata.size()));
+  os.write(zeros, padded - static_cast<int64_t>(metadata.size()));
+  fileOffset += 8 + padded;
+  return {start, 8 + metadataLength, 0, bodyLength};
+}
+
+inline void writePadding(std::ostream& os, const int64_t size) {
+  static constexpr char zeros[bufferAlignment] {};
+  os.write(zeros, alignBuffer(size) - size);
+}
+}  // namespace arrow
+
+// arrowColumn
+// a column of an arrow file: the values of a history, oldest first, split in
+// record batches; the rows after the end of a history shorter than the
+// others are nulls
+class arrowColumn {
+ public:
+  arrowColumn(std::string name, arrow::type type, const size_t size) :
+  name_ (std::move(name)),
+  type_ (std::move(type)),
+  size_ (size)
+  {}
+
+  const std::string& getName() const noexcept {
+    return name_;
+  }
+
+  const arrow::type& getType() const noexcept {
+    return type_;
+  }
+
+  const std::vector<arrow::keyValue>& getMetadata() const noexcept {
+    return metadata_;
+  }
+
+  size_t size() const noexcept {
+    return size_;
+  }
+
+ protected:
+  std::string name_;
+  arrow::type type_;
+  std::vector<arrow::keyValue> metadata_ {};
+  size_t size_;
+
+  // the rows of [begin, begin + rows) holding a value
+  size_t validRows(const size_t begin, const size_t rows) const noexcept {
+    return (begin < size_) ? std::min(rows, size_ - begin) : 0;
+  }
+
+  // the validity bitmap is left out when there are no nulls
+  void addValidity(const size_t begin,
+                   const size_t rows,
+                   std::vector<arrow::fieldNode>& nodes,
+                   std::vector<arrow::buffer>& buffers,
+                   int64_t& bodyLength) const {
+    const auto valid {validRows(begin, rows)};
+    nodes.push_back({static_cast<int64_t>(rows), static_cast<int64_t>(rows - valid)});
+    addBuffer((valid == rows) ? 0 : static_cast<int64_t>((rows + 7) / 8), buffers, bodyLength);
+  }
+
+  static void addBuffer(const int64_t length, std::vector<arrow::buffer>& buffers, int64_t& bodyLength) {
+    buffers.push_back({bodyLength, length});
+    bodyLength += arrow::alignBuffer(length);
+  }
+
+  void writeValidity(std::ostream& os, const size_t begin, const size_t rows) const {
+    const auto valid {validRows(begin, rows)};
+    if ( valid == rows ) {
+      return;
+    }
+    std::vector<char> bitmap ((rows + 7) / 8, 0);
+    std::fill_n(bitmap.begin(), valid / 8, static_cast<char>(0xff));
+    if ( 0 != valid % 8 ) {
+      bitmap[valid / 8] = static_cast<char>((1u << (valid % 8)) - 1);
+    }
+    os.write(bitmap.data(), static_cast<std::streamsize>(bitmap.size()));
+    arrow::writePadding(os, static_cast<int64_t>(bitmap.size()));
+  }
+};  // class arrowColumn
+
+// arrowFixedColumn
+// a column of numbers, or of booleans packed in a bitmap: the values are
+// copied from the history through project() to the type S stored in the file
+template <typename E, typename S, typename Project>
+class arrowFixedColumn : public arrowColumn {
+ public:
+  arrowFixedColumn(std::string name, arrow::type type, const std::deque<E>& history, Project project) :
+  arrowColumn(std::move(name), std::move(type), history.size()),
+  history_ (history),
+  project_ (std::move(project))
+  {}
+
+  void prepareBatch(size_t, size_t) {}
+
+  void addBatchLayout(const size_t begin,
+                      const size_t rows,
+                      std::vector<arrow::fieldNode>& nodes,
+                      std::vector<arrow::buffer>& buffers,
+                      int64_t& bodyLength) const {
+    addValidity(begin, rows, nodes, buffers, bodyLength);
+    addBuffer(valuesBytes(rows), buffers, bodyLength);
+  }
+
+  void writeBatch(std::ostream& os, const size_t begin, const size_t rows) const {
+    writeValidity(os, begin, rows);
+    const auto valid {validRows(begin, rows)};
+    auto it {history_.crbegin()};
+    // a column shorter than the others has no value past its end
+    if ( valid > 0 ) {
+      it += static_cast<std::ptrdiff_t>(begin);
+    }
+    if constexpr ( std::is_same_v<S, bool> ) {
+      std::vector<uint8_t> bits ((rows + 7) / 8, 0);
+      for (size_t i {0}; i < valid; ++i, ++it) {
+        bits[i / 8] |= static_cast<uint8_t>(project_(*it) ? (1u << (i % 8)) : 0);
+      }
+      os.write(reinterpret_cast<const char*>(bits.data()), static_cast<std::streamsize>(bits.size()));
+    }
+    else {
+      // copied out of the deque in chunks, to write many values at a time
+      std::vector<S> chunk (std::min<size_t>(rows, 65'536));
+      for (size_t done {0}; done < rows; ) {
+        const auto count {std::min(chunk.size(), rows - done)};
+        const auto values {(done < valid) ? std::min(count, valid - done) : 0};
+        std::transform(it, it + static_cast<std::ptrdiff_t>(values), chunk.begin(), project_);
+        std::fill(chunk.begin() + static_cast<std::ptrdiff_t>(values), chunk.end(), S{});
+        it += static_cast<std::ptrdiff_t>(values);
+        os.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(count * sizeof(S)));
+        done += count;
+      }
+    }
+    arrow::writePadding(os, valuesBytes(rows));
+  }
+
+  void addMetadata(std::string key, std::string value) {
+    metadata_.push_back({std::move(key), std::move(value)});
+  }
+
+ private:
+  const std::deque<E>& history_;
+  Project project_;
+
+  static int64_t valuesBytes(const size_t rows) noexcept {
+    if constexpr ( std::is_same_v<S, bool> ) {
+      return static_cast<int64_t>((rows + 7) / 8);
+    }
+    else {
+      return static_cast<int64_t>(rows * sizeof(S));
+    }
+  }
+};  // class arrowFixedColumn
+
+// arrowTextColumn
+// a column of UTF-8 text with 64-bit offsets: the standard strings are
+// written in place, the others are transcoded or formatted by their
+// operator<< for each record batch
+template <typename T>
+class arrowTextColumn : public arrowColumn {
+ public:
+  arrowTextColumn(std::string name, const std::deque<T>& history) :
+  arrowColumn(std::move(name), arrow::type {arrow::largeUtf8Type}, history.size()),
+  history_ (history)
+  {}
+
+  void prepareBatch(const size_t begin, const size_t rows) {
+    const auto valid {validRows(begin, rows)};
+    auto it {history_.crbegin()};
+    if ( valid > 0 ) {
+      it += static_cast<std::ptrdiff_t>(begin);
+    }
+    offsets_.assign(1, 0);
+    text_.clear();
+    for (size_t i {0}; i < valid; ++i, ++it) {
+      offsets_.push_back(offsets_.back() + static_cast<int64_t>(appendText(*it)));
+    }
+    offsets_.resize(rows + 1, offsets_.back());
+  }
+
+  void addBatchLayout(const size_t begin,
+                      const size_t rows,
+                      std::vector<arrow::fieldNode>& nodes,
+                      std::vector<arrow::buffer>& buffers,
+                      int64_t& bodyLength) const {
+    addValidity(begin, rows, nodes, buffers, bodyLength);
+    addBuffer(static_cast<int64_t>(offsets_.size() * sizeof(int64_t)), buffers, bodyLength);
+    addBuffer(offsets_.back(), buffers, bodyLength);
+  }
+
+  void writeBatch(std::ostream& os, const size_t begin, const size_t rows) const {
+    writeValidity(os, begin, rows);
+    const auto offsetsBytes {static_cast<std::streamsize>(offsets_.size() * sizeof(int64_t))};
+    os.write(reinterpret_cast<const char*>(offsets_.data()), offsetsBytes);
+    arrow::writePadding(os, offsetsBytes);
+    if constexpr ( IsAnyOf<T, std::string, std::u8string> ) {
+      const auto valid {validRows(begin, rows)};
+      auto it {history_.crbegin()};
+      if ( valid > 0 ) {
+        it += static_cast<std::ptrdiff_t>(begin);
+      }
+      for (size_t i {valid}; i > 0; --i, ++it) {
+        os.write(reinterpret_cast<const char*>(it->data()), static_cast<std::streamsize>(it->size()));
+      }
+    }
+    else {
+      os.write(text_.data(), static_cast<std::streamsize>(text_.size()));
+    }
+    arrow::writePadding(os, offsets_.back());
+  }
+
+ private:
+  const std::deque<T>& history_;
+  std::vector<int64_t> offsets_ {};
+  std::string text_ {};
+  std::ostringstream scratch_ {};
+
+  // the size of the UTF-8 text of value, added to text_ unless written in place
+  size_t appendText(const T& value) {
+    if constexpr ( IsAnyOf<T, std::string, std::u8string> ) {
+      return value.size();
+    }
+    else if constexpr ( IsAnyOf<T, std::wstring, std::u16string, std::u32string> ) {
+      const auto size {text_.size()};
+      return appendUtf8(text_, std::basic_string_view<typename T::value_type>(value)).size() - size;
+    }
+    else {
+      scratch_.str(std::string {});
+      scratch_ << value;
+      text_ += scratch_.view();
+      return scratch_.view().size();
+    }
+  }
+};  // class arrowTextColumn
+
+template <typename T>
+concept arrowValue = (std::is_arithmetic_v<T> && !std::is_same_v<T, long double>) ||
+                     AnyStandardString<T> ||
+                     is_bigint_v<T>;
+
+template <typename T>
+  requires arrowValue<T>
+auto makeArrowValueColumn(std::string name, const std::deque<T>& history) {
+  if constexpr ( std::is_arithmetic_v<T> ) {
+    arrow::type type {};
+    if constexpr ( std::is_same_v<T, bool> ) {
+      type.id_ = arrow::boolType;
+    }
+    else if constexpr ( std::is_floating_point_v<T> ) {
+      type.id_ = arrow::floatingPointType;
+      type.precision_ = (sizeof(T) == sizeof(float)) ? 1 : 2;
+    }
+    else {
+      type.bitWidth_ = sizeof(T) * 8;
+      type.isSigned_ = std::is_signed_v<T>;
+    }
+    auto identity = [] (const T& value) { return value; };
+    return arrowFixedColumn<T, T, decltype(identity)> {std::move(name), type, history, identity};
+  }
+  else {
+    return arrowTextColumn<T> {std::move(name), history};
+  }
+}
+
+// the time points of a system clock are timestamps in UTC; those of any
+// other clock have no meaning outside of the process, and are written as
+// the time tags, durations from the time point epoch of the memvarTimed
+template <typename T, typename Time, typename Clock>
+auto makeArrowTimeColumn(std::string name, const memvarTimed<T, Time, Clock>& mvt) {
+  using period = typename Time::period;
+  arrow::type type {};
+  type.unit_ = std::is_same_v<period, std::ratio<1>> ? arrow::second :
+               std::is_same_v<period, std::milli> ? arrow::millisecond :
+               std::is_same_v<period, std::micro> ? arrow::microsecond : arrow::nanosecond;
+  using unitDuration = std::conditional_t<std::is_same_v<period, std::ratio<1>>, std::chrono::seconds,
+                       std::conditional_t<std::is_same_v<period, std::milli>, std::chrono::milliseconds,
+                       std::conditional_t<std::is_same_v<period, std::micro>, std::chrono::microseconds,
+                                          std::chrono::nanoseconds>>>;
+  const auto epoch {mvt.getTimePoint() - mvt.getTimeTag()};
+  constexpr bool systemClock {std::is_same_v<Clock, std::chrono::system_clock>};
+  if constexpr ( systemClock ) {
+    type.id_ = arrow::timestampType;
+    type.timezone_ = "UTC";
+  }
+  else {
+    type.id_ = arrow::durationType;
+  }
+  auto project = [epoch] (const auto& when) {
+    return static_cast<int64_t>(std::chrono::duration_cast<unitDuration>(
+      systemClock ? when.time_since_epoch() : when - epoch).count());
+  };
+  arrowFixedColumn<std::decay_t<decltype(epoch)>, int64_t, decltype(project)> column {
+    std::move(name), type, mvt.getTimeHistory(), project};
+  if constexpr ( !systemClock ) {
+    column.addMetadata("memvar.epoch", std::to_string(
+      std::chrono::duration_cast<unitDuration>(epoch.time_since_epoch()).count()));
+  }
+  return column;
+}
+
+template <typename... Columns>
+void writeArrowFile(const std::string& path, const size_t batchRows, std::tuple<Columns...>& columns) {
+  using arrow::fieldNode;
+  using arrow::buffer;
+  const auto rows {std::apply([] (const auto&... column) { return std::max({column.size()...}); }, columns)};
+  auto forEachColumn = [&columns] (auto&& f) {
+    std::apply([&f] (auto&... column) { (f(column), ...); }, columns);
+  };
+
+  auto schema = [&forEachColumn] (flatbufferBuilder& fbb) {
+    std::vector<flatbufferBuilder::ref> fields {};
+    forEachColumn([&fbb, &fields] (const auto& column) {
+      fields.push_back(arrow::createField(fbb, column.getName(), column.getType(), column.getMetadata()));
+    });
+    const auto fieldsRef {fbb.createOffsetVector(fields)};
+    fbb.startTable();
+    fbb.addOffset(1, fieldsRef);
+    fbb.addScalar<int16_t>(0, 0);
+    return fbb.endTable();
+  };
+  auto message = [] (flatbufferBuilder& fbb,
+                     const arrow::messageHeader type,
+                     const flatbufferBuilder::ref header,
+                     const int64_t bodyLength) {
+    fbb.startTable();
+    fbb.addScalar<int64_t>(3, bodyLength);
+    fbb.addOffset(2, header);
+    fbb.addScalar<int16_t>(0, arrow::metadataV5);
+    fbb.addScalar<uint8_t>(1, type);
+    return fbb.finish(fbb.endTable());
+  };
+
+  std::ofstream os {path, std::ios::binary | std::ios::trunc};
+  if ( !os ) {
+    throw std::system_error(errno, std::generic_category(), "open " + path);
+  }
+  os.write(arrow::paddedMagic, sizeof(arrow::paddedMagic));
+  int64_t fileOffset {sizeof(arrow::paddedMagic)};
+  {
+    flatbufferBuilder fbb {};
+    arrow::writeMessage(os, fileOffset, message(fbb, arrow::schema, schema(fbb), 0), 0);
+  }
+
+  std::vector<arrow::block> batches {};
+  for (size_t begin {0}; begin < rows; begin += batchRows) {
+    const auto count {std::min(batchRows, rows - begin)};
+    std::vector<fieldNode> nodes {};
+    std::vector<buffer> buffers {};
+    int64_t bodyLength {0};
+    forEachColumn([&] (auto& column) {
+      column.prepareBatch(begin, count);
+      column.addBatchLayout(begin, count, nodes, buffers, bodyLength);
+    });
+    flatbufferBuilder fbb {};
+    const auto nodesRef {fbb.createVector(std::span<const fieldNode> {nodes})};
+    const auto buffersRef {fbb.createVector(std::span<const buffer> {buffers})};
+    fbb.startTable();
+    fbb.addScalar<int64_t>(0, static_cast<int64_t>(count));
+    fbb.addOffset(1, nodesRef);
+    fbb.addOffset(2, buffersRef);
+    const auto batch {fbb.endTable()};
+    batches.push_back(arrow::writeMessage(os, fileOffset, message(fbb, arrow::recordBatch, batch, bodyLength), bodyLength));
+    forEachColumn([&] (const auto& column) {
+      column.writeBatch(os, begin, count);
+    });
+    fileOffset += bodyLength;
+  }
+  // the end of the stream, then the footer locating the record batches
+  const uint64_t endOfStream {arrow::continuation};
+  os.write(reinterpret_cast<const char*>(&endOfStream), sizeof(endOfStream));
+
+  flatbufferBuilder fbb {};
+  const auto schemaRef {schema(fbb)};
+  const auto dictionaries {fbb.createVector(std::span<const arrow::block> {})};
+  const auto recordBatches {fbb.createVector(std::span<const arrow::block> {batches})};
+  fbb.startTable();
+  fbb.addOffset(1, schemaRef);
+  fbb.addOffset(2, dictionaries);
+  fbb.addOffset(3, recordBatches);
+  fbb.addScalar<int16_t>(0, arrow::metadataV5);
+  const auto footer {fbb.finish(fbb.endTable())};
+  const auto footerLength {static_cast<int32_t>(footer.size())};
+  os.write(footer.data(), footerLength);
+  os.write(reinterpret_cast<const char*>(&footerLength), sizeof(footerLength));
+  os.write(arrow::magic, arrow::magicSize);
+  os.flush();
+  if ( !os ) {
+    throw std::system_error(errno, std::generic_category(), "write " + path);
+  }
+}
+}  // namespace detail
+
+// arrowSeries
+// a memvarTimed exported with others to the same arrow file, under a name
+template <typename T, typename Time, typename Clock>
+struct arrowSeries {
+  std::string name_;
+  const memvarTimed<T, Time, Clock>& mvt_;
+};
+
+template <typename T, typename Time, typename Clock>
+arrowSeries(std::string, const memvarTimed<T, Time, Clock>&) -> arrowSeries<T, Time, Clock>;
+
+namespace detail
+{
+template <typename T>
+struct is_arrowSeries : std::false_type {};
+
+template <typename T, typename Time, typename Clock>
+struct is_arrowSeries<arrowSeries<T, Time, Clock>> : std::true_type {};
+}  // namespace detail
+
+// write the history of mvt, oldest first, to the file at path, replacing it,
+// in the arrow IPC file format: a "time" column and a "value" column, in
+// record batches of batchRows rows
+// the time points are UTC timestamps for a system clock, the time tags
+// otherwise; numbers and booleans are written as they are, the other values
+// as UTF-8 text
+template <typename T, typename Time, typename Clock>
+  requires detail::arrowValue<T>
+void exportArrow(const std::string& path,
+                 const memvarTimed<T, Time, Clock>& mvt,
+                 const size_t batchRows = 65'536) {
+  if ( 0 == batchRows ) {
+    throw std::invalid_argument("memvar arrow export: batchRows must be greater than 0");
+  }
+  auto columns {std::make_tuple(detail::makeArrowTimeColumn("time", mvt),
+                                detail::makeArrowValueColumn("value", mvt.getMemVarHistory()))};
+  detail::writeArrowFile(path, batchRows, columns);
+}
+
+// write the histories of several memvarTimed to one arrow file: the columns
+// "<name>.time" and "<name>" for each of them, the histories shorter than
+// the longest one padded with nulls
+template <typename... Series>
+  requires (detail::is_arrowSeries<Series>::value && ...)
+void exportArrow(const std::string& path, const size_t batchRows, const Series&... series) {
+  static_assert(sizeof...(Series) > 0, "At least one history required.");
+  if ( 0 == batchRows ) {
+    throw std::invalid_argument("memvar arrow export: batchRows must be greater than 0");
+  }
+  auto columns {std::tuple_cat(std::make_tuple(
+    detail::makeArrowTimeColumn(series.name_ + ".time", series.mvt_),
+    detail::makeArrowValueColumn(series.name_, series.mvt_.getMemVarHistory()))...)};
+  detail::writeArrowFile(path, batchRows, columns);
+}
+}  // namespace memvar
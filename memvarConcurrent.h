@@ -0,0 +1,788 @@
+//
+// memvarConcurrent.h
+//
+#pragma once
+
+#include "memvar.h"
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stop_token>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <span>
+#include <tuple>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+namespace detail
+{
+// keeps apart the data written by different threads
+inline constexpr size_t cacheLineSize {64};
+
+// seqlockSlot
+// a history slot published with its own sequence number: the sequence is odd
+// while the writer copies a value into the slot, and it is 2 * (n + 1) once
+// the n-th value written to the memvar is stored in the slot
+template <typename T>
+struct seqlockSlot {
+  std::atomic<uint64_t> sequence_ {0};
+  T value_ {};
+};
+
+template <typename T>
+void writeSlot(seqlockSlot<T>& slot, const uint64_t n, const T& value) noexcept {
+  slot.sequence_.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&slot.value_, &value, sizeof(T));
+  slot.sequence_.store(2 * (n + 1), std::memory_order_release);
+}
+
+// returns false if the slot does not hold the n-th value, or if the writer
+// overwrote it while it was being copied
+template <typename T>
+bool readSlot(const seqlockSlot<T>& slot, const uint64_t n, T& value) noexcept {
+  const uint64_t published {2 * (n + 1)};
+  if ( slot.sequence_.load(std::memory_order_acquire) != published ) {
+    return false;
+  }
+  std::memcpy(&value, &slot.value_, sizeof(T));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence_.load(std::memory_order_relaxed) == published;
+}
+
+// spscRing
+// a bounded lock-free queue between one producer thread and one consumer thread
+template <typename Item>
+class spscRing {
+ public:
+  explicit spscRing(const size_t capacity) :
+  size_ (std::bit_ceil(std::max<uint64_t>(capacity, 2))),
+  mask_ (size_ - 1),
+  items_ (std::make_unique<Item[]>(size_))
+  {}
+
+  spscRing(const spscRing& rhs) = delete;
+  spscRing& operator=(const spscRing& rhs) = delete;
+
+  // producer side; returns false if the ring is full
+  bool push(const Item& item) {
+    const auto head {head_.load(std::memory_order_relaxed)};
+    if ( head - cachedTail_ == size_ ) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      if ( head - cachedTail_ == size_ ) {
+        return false;
+      }
+    }
+    items_[head & mask_] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side: hand all the queued items to f, oldest first
+  // returns the number of items consumed
+  template <typename F>
+  size_t drain(F&& f) {
+    const auto tail {tail_.load(std::memory_order_relaxed)};
+    const auto head {head_.load(std::memory_order_acquire)};
+    for (auto i {tail}; i != head; ++i) {
+      f(std::move(items_[i & mask_]));
+    }
+    tail_.store(head, std::memory_order_release);
+    return static_cast<size_t>(head - tail);
+  }
+
+  size_t capacity() const noexcept {
+    return static_cast<size_t>(size_);
+  }
+
+ private:
+  // written by the producer
+  alignas(cacheLineSize) std::atomic<uint64_t> head_ {0};
+  uint64_t cachedTail_ {0};
+  // written by the consumer
+  alignas(cacheLineSize) std::atomic<uint64_t> tail_ {0};
+  // set up by the constructor, then read-only
+  alignas(cacheLineSize) const uint64_t size_;
+  const uint64_t mask_;
+  std::unique_ptr<Item[]> items_;
+};  // class spscRing
+}  // namespace detail
+
+// memvarConcurrent
+// a memvar written by one thread and read by many threads without locks
+// the values are stored in a ring; the writer publishes each value with a
+// release-store of the ring head and never waits for the readers, and
+// the readers check the sequence number of the slot they copy, retrying
+// only when the writer laps the ring while they are copying
+// only trivially copyable types allowed
+template <typename T>
+class memvarConcurrent : public memvarBase {
+ public:
+  using historyValue = std::tuple<T, bool>;
+
+  memvarConcurrent() :
+  memvarConcurrent(T{}, historyCapacityDefault_)
+  {}
+
+  explicit memvarConcurrent(const T& value,
+                            const capacityType historyCapacity = historyCapacityDefault_) :
+  memvarBase(historyCapacity) {
+    static_assert(std::is_trivially_copyable_v<T>, "Trivially copyable type required.");
+    checkHistoryCapacity(historyCapacity_);
+    // the ring is larger than the history capacity: the slots in excess give
+    // the readers room before the writer overwrites the oldest value
+    ringSize_ = std::bit_ceil(static_cast<uint64_t>(historyCapacity_) + 1);
+    ringMask_ = ringSize_ - 1;
+    ring_ = std::make_unique<detail::seqlockSlot<T>[]>(ringSize_);
+    capacity_.store(static_cast<uint64_t>(historyCapacity_), std::memory_order_relaxed);
+    setValue(value);
+  }
+
+  memvarConcurrent(const memvarConcurrent& rhs) = delete;
+  memvarConcurrent& operator=(const memvarConcurrent& rhs) = delete;
+  memvarConcurrent(memvarConcurrent&& rhs) = delete;
+  memvarConcurrent& operator=(memvarConcurrent&& rhs) = delete;
+
+  ~memvarConcurrent() override = default;
+
+  // writer side: one thread only
+  memvarConcurrent& operator=(const T& rhs) noexcept {
+    setValue(rhs);
+    return *this;
+  }
+
+  // reader side: any thread
+  operator T() const noexcept {
+    return getValue();
+  }
+
+  T operator()() const noexcept {
+    return getValue();
+  }
+
+  T operator()(const capacityType index) const noexcept {
+    return std::get<T>(getHistoryValue(index));
+  }
+
+  auto getHistoryValue(const capacityType index) const noexcept -> historyValue {
+    T value {};
+    while ( true ) {
+      const auto head {head_.load(std::memory_order_acquire)};
+      if ( (index < 0) || (index >= historySize(head)) ) {
+        return std::make_tuple(T{}, true);
+      }
+      const auto n {head - 1 - static_cast<uint64_t>(index)};
+      if ( detail::readSlot(ring_[n & ringMask_], n, value) ) {
+        return std::make_tuple(value, false);
+      }
+    }
+  }
+
+  capacityType getHistorySize() const noexcept {
+    return historySize(head_.load(std::memory_order_acquire));
+  }
+
+  auto isHistoryFull() const noexcept {
+    return getHistorySize() >= getHistoryCapacity();
+  }
+
+  // any thread: the capacity can change on the writer thread
+  capacityType getHistoryCapacity() const noexcept {
+    return static_cast<capacityType>(capacity_.load(std::memory_order_acquire));
+  }
+
+  // the largest capacity the ring allocated by the constructor can hold
+  capacityType getMaxHistoryCapacity() const noexcept {
+    return static_cast<capacityType>(ringSize_ - 1);
+  }
+
+  // writer side: shrinking drops the oldest values for good, growing is
+  // bounded by the ring and keeps the values already in the history
+  void setHistoryCapacity(const capacityType historyCapacity) {
+    checkHistoryCapacity(historyCapacity);
+    if ( historyCapacity > getMaxHistoryCapacity() ) {
+      throw std::invalid_argument("ERROR: The history capacity of a memvarConcurrent cannot grow past " +
+                                  std::to_string(getMaxHistoryCapacity()) + ".");
+    }
+    const auto head {head_.load(std::memory_order_relaxed)};
+    if ( historyCapacity < historySize(head) ) {
+      first_.store(head - static_cast<uint64_t>(historyCapacity), std::memory_order_release);
+    }
+    capacity_.store(static_cast<uint64_t>(historyCapacity), std::memory_order_release);
+    historyCapacity_ = historyCapacity;
+  }
+
+  // the number of values written so far, the initial one included
+  uint64_t getWriteCount() const noexcept {
+    return head_.load(std::memory_order_acquire);
+  }
+
+  // the sequence number of the current value
+  sequenceType getSequence() const noexcept {
+    return head_.load(std::memory_order_acquire) - 1;
+  }
+
+  // block until a value newer than the one with sequence number lastSeen is
+  // written; returns the sequence number of the current value, so
+  // the return value - lastSeen - 1 values were missed
+  sequenceType waitForChange(const sequenceType lastSeen) const noexcept {
+    auto head {head_.load(std::memory_order_acquire)};
+    while ( head <= lastSeen + 1 ) {
+      head_.wait(head, std::memory_order_acquire);
+      head = head_.load(std::memory_order_acquire);
+    }
+    return head - 1;
+  }
+
+ private:
+  // written by the writer, read by the readers
+  alignas(detail::cacheLineSize) std::atomic<uint64_t> head_ {0};
+  // the history capacity, and the sequence number before which
+  // setHistoryCapacity dropped the values
+  std::atomic<uint64_t> capacity_ {0};
+  std::atomic<uint64_t> first_ {0};
+  // set up by the constructor, then read-only
+  alignas(detail::cacheLineSize) std::unique_ptr<detail::seqlockSlot<T>[]> ring_ {};
+  uint64_t ringSize_ {};
+  uint64_t ringMask_ {};
+
+  capacityType historySize(const uint64_t head) const noexcept {
+    const auto first {first_.load(std::memory_order_acquire)};
+    return static_cast<capacityType>(std::min({head, capacity_.load(std::memory_order_acquire),
+                                               (head > first) ? head - first : 0}));
+  }
+
+  T getValue() const noexcept {
+    return std::get<T>(getHistoryValue(0));
+  }
+
+  void setValue(const T& value) noexcept {
+    // only the writer stores the head: a relaxed load reads its own value
+    const auto n {head_.load(std::memory_order_relaxed)};
+    detail::writeSlot(ring_[n & ringMask_], n, value);
+    head_.store(n + 1, std::memory_order_release);
+    head_.notify_all();
+  }
+};  // class memvarConcurrent
+
+template <typename T>
+T getHistoryValue(const memvarConcurrent<T>& mvc, const memvarBase::capacityType index) {
+  return std::get<T>(mvc.getHistoryValue(index));
+}
+
+// memvarSegmented
+// a memvar written by one thread whose whole history can be read by other
+// threads through snapshots
+// the values are appended to fixed size segments that are never written
+// again once their values are published; a segment is linked to the next,
+// newer one before any value of the latter is published, and the writer
+// drops its reference to the oldest segment once all its values are out of
+// the history
+// a snapshot pins the oldest segment, and so all the newer ones, present
+// when it is taken: it costs one atomic load of the oldest segment and one
+// of the write count, it reads the values in place, and the segments it
+// pins are freed when the last snapshot holding them goes away
+// the writer stores the oldest segment once per segment, so it can only
+// contend with a snapshot being taken at that moment
+// a segment holds at least 1 value and at most the history capacity: a
+// larger segment size is cut down to the history capacity
+// the reads on the memvar itself are for the writer thread only
+template <typename T>
+class memvarSegmented : public memvarBase {
+ public:
+  using historyValue = std::tuple<T, bool>;
+
+  static constexpr size_t segmentSizeDefault_ {4'096};
+
+ private:
+  struct segment {
+    segment(const uint64_t first, const size_t size) :
+    first_ (first),
+    values_ (std::make_unique<T[]>(size))
+    {}
+
+    segment(const segment& rhs) = delete;
+    segment& operator=(const segment& rhs) = delete;
+
+    // a snapshot can pin a chain of any length: the newer segments held by
+    // this one only are unlinked one at a time, instead of being destroyed
+    // by a recursion as deep as the chain
+    ~segment() {
+      auto next {std::move(next_)};
+      while ( next && (1 == next.use_count()) ) {
+        next = std::move(next->next_);
+      }
+    }
+
+    // the write number of values_[0]
+    const uint64_t first_;
+    std::unique_ptr<T[]> values_;
+    // the newer segment, linked before any of its values is published
+    std::shared_ptr<segment> next_ {};
+  };
+
+ public:
+  // historySnapshot
+  // a read-only view of the history of a memvarSegmented when it was taken
+  class historySnapshot {
+   public:
+    historySnapshot() = default;
+
+    capacityType getHistorySize() const noexcept {
+      return static_cast<capacityType>(end_ - begin_);
+    }
+
+    // the number of values written to the memvar when the snapshot was taken
+    uint64_t getWriteCount() const noexcept {
+      return end_;
+    }
+
+    T operator()() const {
+      return std::get<T>(getHistoryValue(0));
+    }
+
+    T operator()(const capacityType index) const {
+      return std::get<T>(getHistoryValue(index));
+    }
+
+    // the index counts back from the newest value, as in a memvar
+    auto getHistoryValue(const capacityType index) const -> historyValue {
+      if ( (index < 0) || (index >= getHistorySize()) ) {
+        return std::make_tuple(T{}, true);
+      }
+      const auto n {end_ - 1 - static_cast<uint64_t>(index)};
+      const segment* seg {oldest_.get()};
+      while ( n >= seg->first_ + segmentSize_ ) {
+        seg = seg->next_.get();
+      }
+      return std::make_tuple(seg->values_[n - seg->first_], false);
+    }
+
+    // call f with each contiguous span of values, from the oldest value to
+    // the newest one
+    template <typename F>
+    void forEachSpan(F&& f) const {
+      const segment* seg {oldest_.get()};
+      auto n {begin_};
+      while ( n < end_ ) {
+        while ( n >= seg->first_ + segmentSize_ ) {
+          seg = seg->next_.get();
+        }
+        const auto count {std::min<uint64_t>(end_, seg->first_ + segmentSize_) - n};
+        f(std::span<const T>(seg->values_.get() + (n - seg->first_), static_cast<size_t>(count)));
+        n += count;
+      }
+    }
+
+    // call f with each value, from the oldest value to the newest one
+    template <typename F>
+    void forEach(F&& f) const {
+      forEachSpan([&f] (std::span<const T> values) {
+        for (const auto& value : values) {
+          f(value);
+        }
+      });
+    }
+
+    auto getHistoryMinMax() const {
+      bool first {true};
+      T min {};
+      T max {};
+      forEach([&first, &min, &max] (const T& value) {
+        if ( first || (value < min) ) {
+          min = value;
+        }
+        if ( first || (max < value) ) {
+          max = value;
+        }
+        first = false;
+      });
+      return std::make_tuple(min, max);
+    }
+
+   private:
+    friend class memvarSegmented;
+
+    std::shared_ptr<const segment> oldest_ {};
+    uint64_t begin_ {0};
+    uint64_t end_ {0};
+    uint64_t segmentSize_ {0};
+
+    historySnapshot(std::shared_ptr<const segment> oldest,
+             const uint64_t begin,
+             const uint64_t end,
+             const uint64_t segmentSize) :
+    oldest_ (std::move(oldest)),
+    begin_ (begin),
+    end_ (end),
+    segmentSize_ (segmentSize)
+    {}
+  };  // class historySnapshot
+
+  memvarSegmented() :
+  memvarSegmented(T{}, historyCapacityDefault_)
+  {}
+
+  explicit memvarSegmented(const T& value,
+                           const capacityType historyCapacity = historyCapacityDefault_,
+                           const size_t segmentSize = segmentSizeDefault_) :
+  memvarBase(historyCapacity) {
+    checkHistoryCapacity(historyCapacity_);
+    segmentSize_ = std::min<uint64_t>(std::max<size_t>(segmentSize, 1), static_cast<uint64_t>(historyCapacity_));
+    writerOldest_ = std::make_shared<segment>(0, segmentSize_);
+    newest_ = writerOldest_.get();
+    oldest_.store(writerOldest_, std::memory_order_release);
+    capacity_.store(static_cast<uint64_t>(historyCapacity_), std::memory_order_relaxed);
+    setValue(value);
+  }
+
+  memvarSegmented(const memvarSegmented& rhs) = delete;
+  memvarSegmented& operator=(const memvarSegmented& rhs) = delete;
+  memvarSegmented(memvarSegmented&& rhs) = delete;
+  memvarSegmented& operator=(memvarSegmented&& rhs) = delete;
+
+  ~memvarSegmented() override = default;
+
+  // the values per segment, after the history capacity cut it down
+  size_t getSegmentSize() const noexcept {
+    return static_cast<size_t>(segmentSize_);
+  }
+
+  // any thread: O(1), the writer goes on while the snapshot is alive
+  historySnapshot snapshot() const {
+    // load the oldest segment first: all the values published after it are
+    // reachable from it
+    auto oldest {oldest_.load(std::memory_order_acquire)};
+    const auto end {head_.load(std::memory_order_acquire)};
+    const auto begin {std::max(oldest->first_, historyBegin(end))};
+    return historySnapshot(std::move(oldest), begin, end, segmentSize_);
+  }
+
+  // any thread: the capacity can change on the writer thread
+  capacityType getHistoryCapacity() const noexcept {
+    return static_cast<capacityType>(capacity_.load(std::memory_order_acquire));
+  }
+
+  // writer side: shrinking drops the oldest values for good, and their
+  // segments once no snapshot holds them; growing keeps the values already
+  // in the history, the segment size does not change
+  void setHistoryCapacity(const capacityType historyCapacity) {
+    checkHistoryCapacity(historyCapacity);
+    const auto head {head_.load(std::memory_order_relaxed)};
+    if ( historyCapacity < getHistorySize() ) {
+      first_.store(head - static_cast<uint64_t>(historyCapacity), std::memory_order_release);
+    }
+    capacity_.store(static_cast<uint64_t>(historyCapacity), std::memory_order_release);
+    historyCapacity_ = historyCapacity;
+    dropSegments(head);
+  }
+
+  // writer side: one thread only
+  memvarSegmented& operator=(const T& rhs) {
+    setValue(rhs);
+    return *this;
+  }
+
+  operator T() const {
+    return getValue();
+  }
+
+  T operator()() const {
+    return getValue();
+  }
+
+  T operator()(const capacityType index) const {
+    return std::get<T>(getHistoryValue(index));
+  }
+
+  auto getHistoryValue(const capacityType index) const -> historyValue {
+    return snapshot().getHistoryValue(index);
+  }
+
+  capacityType getHistorySize() const noexcept {
+    const auto head {head_.load(std::memory_order_acquire)};
+    return static_cast<capacityType>(head - historyBegin(head));
+  }
+
+  uint64_t getWriteCount() const noexcept {
+    return head_.load(std::memory_order_acquire);
+  }
+
+  sequenceType getSequence() const noexcept {
+    return head_.load(std::memory_order_acquire) - 1;
+  }
+
+  // block until a value newer than the one with sequence number lastSeen is
+  // written; returns the sequence number of the current value
+  sequenceType waitForChange(const sequenceType lastSeen) const noexcept {
+    auto head {head_.load(std::memory_order_acquire)};
+    while ( head <= lastSeen + 1 ) {
+      head_.wait(head, std::memory_order_acquire);
+      head = head_.load(std::memory_order_acquire);
+    }
+    return head - 1;
+  }
+
+ private:
+  alignas(detail::cacheLineSize) std::atomic<uint64_t> head_ {0};
+  std::atomic<std::shared_ptr<segment>> oldest_ {};
+  // the history capacity, and the sequence number before which
+  // setHistoryCapacity dropped the values
+  std::atomic<uint64_t> capacity_ {0};
+  std::atomic<uint64_t> first_ {0};
+  // owned by the writer
+  alignas(detail::cacheLineSize) std::shared_ptr<segment> writerOldest_ {};
+  segment* newest_ {nullptr};
+  uint64_t segmentSize_ {segmentSizeDefault_};
+
+  // the sequence number of the oldest value in the history
+  uint64_t historyBegin(const uint64_t end) const noexcept {
+    const auto window {capacity_.load(std::memory_order_acquire)};
+    return std::min(end, std::max((end > window) ? end - window : 0, first_.load(std::memory_order_acquire)));
+  }
+
+  T getValue() const {
+    return newest_->values_[head_.load(std::memory_order_relaxed) - 1 - newest_->first_];
+  }
+
+  void setValue(const T& value) {
+    const auto n {head_.load(std::memory_order_relaxed)};
+    if ( n == newest_->first_ + segmentSize_ ) {
+      newest_->next_ = std::make_shared<segment>(n, segmentSize_);
+      newest_ = newest_->next_.get();
+    }
+    newest_->values_[n - newest_->first_] = value;
+    head_.store(n + 1, std::memory_order_release);
+    head_.notify_all();
+    dropSegments(n + 1);
+  }
+
+  // drop the oldest segments once all their values are out of the history
+  void dropSegments(const uint64_t end) {
+    const auto begin {historyBegin(end)};
+    if ( begin < writerOldest_->first_ + segmentSize_ ) {
+      return;
+    }
+    while ( begin >= writerOldest_->first_ + segmentSize_ ) {
+      writerOldest_ = writerOldest_->next_;
+    }
+    oldest_.store(writerOldest_, std::memory_order_release);
+  }
+};  // class memvarSegmented
+
+// memvarMultiProducer
+// a memvarTimed updated by many threads: each producer thread stages its
+// values, with their time points, in its own lock-free ring, and a merge
+// step moves the staged values into the shared history ordered by time point
+// the merge runs when the history is read, when a producer finds its ring
+// full, or periodically on a combiner thread
+// a merge stores the values up to its watermark, the time point it starts
+// at, and keeps the newer ones for the next merge: a producer reading the
+// clock while the merge starts is waited for, and the values staged after
+// it are not older than the watermark, so the history is in time order
+// whatever the merges the values are staged across, as long as the clock
+// does not go backwards
+template <typename T,
+          typename Time = std::chrono::nanoseconds,
+          typename Clock = std::chrono::high_resolution_clock>
+class memvarMultiProducer {
+ public:
+  using history = memvarTimed<T, Time, Clock>;
+  using timePoint = typename history::timePoint;
+  using historyTimedValue = typename history::historyTimedValue;
+
+  static constexpr size_t stagingCapacityDefault_ {4'096};
+
+ private:
+  struct stagedValue {
+    timePoint when_ {};
+    T value_ {};
+  };
+
+ public:
+  // producer
+  // the handle a thread stages its values through; one thread per producer
+  class producer {
+   public:
+    producer(const producer& rhs) = delete;
+    producer& operator=(const producer& rhs) = delete;
+
+    producer& operator=(const T& rhs) {
+      stage(rhs);
+      return *this;
+    }
+
+    void stage(const T& value) {
+      while ( true ) {
+        // the time point is read again after a merge, so that it is not
+        // older than the watermark of that merge
+        busy_.store(true, std::memory_order_seq_cst);
+        const bool pushed {staging_.push({std::chrono::time_point_cast<Time>(Clock::now()), value})};
+        busy_.store(false, std::memory_order_release);
+        if ( pushed ) {
+          return;
+        }
+        // the ring is full: merge the staged values on this thread
+        owner_.merge();
+      }
+    }
+
+   private:
+    friend class memvarMultiProducer;
+
+    memvarMultiProducer& owner_;
+    detail::spscRing<stagedValue> staging_;
+    // between the clock read and the push of a value
+    std::atomic<bool> busy_ {false};
+
+    producer(memvarMultiProducer& owner, const size_t stagingCapacity) :
+    owner_ (owner),
+    staging_ (stagingCapacity)
+    {}
+  };  // class producer
+
+  memvarMultiProducer() :
+  history_ ()
+  {}
+
+  explicit memvarMultiProducer(const T& value,
+                               const memvarBase::capacityType historyCapacity = memvarBase::historyCapacityDefault_,
+                               const size_t stagingCapacity = stagingCapacityDefault_) :
+  stagingCapacity_ (stagingCapacity),
+  history_ (value, historyCapacity)
+  {}
+
+  memvarMultiProducer(const memvarMultiProducer& rhs) = delete;
+  memvarMultiProducer& operator=(const memvarMultiProducer& rhs) = delete;
+  memvarMultiProducer(memvarMultiProducer&& rhs) = delete;
+  memvarMultiProducer& operator=(memvarMultiProducer&& rhs) = delete;
+
+  ~memvarMultiProducer() {
+    stopCombiner();
+  }
+
+  // register a new producer; the reference stays valid for the lifetime of
+  // the memvar
+  producer& makeProducer() {
+    std::lock_guard<std::mutex> lock {producersMtx_};
+    producers_.emplace_back(new producer(*this, stagingCapacity_));
+    return *producers_.back();
+  }
+
+  // move the staged values into the history, ordered by time point
+  // returns the number of values merged
+  size_t merge() {
+    std::lock_guard<std::mutex> lock {mergeMtx_};
+    return mergeStaged();
+  }
+
+  // run merge() every period on a combiner thread
+  void startCombiner(const std::chrono::microseconds period) {
+    stopCombiner();
+    combiner_ = std::jthread([this, period] (std::stop_token stoken) {
+      std::mutex mtx {};
+      std::condition_variable_any cv {};
+      std::unique_lock<std::mutex> lock {mtx};
+      while ( !stoken.stop_requested() ) {
+        merge();
+        cv.wait_for(lock, stoken, period, [] () { return false; });
+      }
+    });
+  }
+
+  void stopCombiner() {
+    if ( combiner_.joinable() ) {
+      combiner_.request_stop();
+      combiner_.join();
+    }
+  }
+
+  // the reads merge the staged values first, so they see every value staged
+  // before them
+  T operator()() {
+    return withHistory([] (const history& h) { return h(); });
+  }
+
+  T operator()(const memvarBase::capacityType index) {
+    return withHistory([index] (const history& h) { return h(index); });
+  }
+
+  auto getHistoryValue(const memvarBase::capacityType index) -> historyTimedValue {
+    return withHistory([index] (const history& h) { return h.getHistoryValue(index); });
+  }
+
+  memvarBase::capacityType getHistorySize() {
+    return withHistory([] (const history& h) { return h.getHistorySize(); });
+  }
+
+  memvarBase::capacityType getHistoryCapacity() const {
+    std::lock_guard<std::mutex> lock {mergeMtx_};
+    return history_.getHistoryCapacity();
+  }
+
+  void setHistoryCapacity(const memvarBase::capacityType historyCapacity) {
+    std::lock_guard<std::mutex> lock {mergeMtx_};
+    history_.setHistoryCapacity(historyCapacity);
+  }
+
+  // call f with the merged history, holding off the other merges and reads
+  template <typename F>
+  auto withHistory(F&& f) {
+    std::lock_guard<std::mutex> lock {mergeMtx_};
+    mergeStaged();
+    return std::invoke(std::forward<F>(f), std::as_const(history_));
+  }
+
+ private:
+  const size_t stagingCapacity_ {stagingCapacityDefault_};
+  std::mutex producersMtx_ {};
+  std::deque<std::unique_ptr<producer>> producers_ {};
+  // guards history_ and merged_
+  mutable std::mutex mergeMtx_ {};
+  history history_;
+  // the values drained and not stored yet, newer than the last watermark
+  std::vector<stagedValue> merged_ {};
+  // declared last: it must stop before the members it uses are gone
+  std::jthread combiner_ {};
+
+  size_t mergeStaged() {
+    // a producer found idle after this reads the clock after this too
+    const auto watermark {std::chrono::time_point_cast<Time>(Clock::now())};
+    {
+      std::lock_guard<std::mutex> lock {producersMtx_};
+      for (auto& p : producers_) {
+        // a producer may have read the clock before the watermark and not
+        // pushed its value yet: it is a few instructions away from it
+        while ( p->busy_.load(std::memory_order_seq_cst) ) {
+          std::this_thread::yield();
+        }
+        p->staging_.drain([this] (stagedValue&& staged) { merged_.emplace_back(std::move(staged)); });
+      }
+    }
+    std::stable_sort(merged_.begin(), merged_.end(),
+                     [] (const stagedValue& lhs, const stagedValue& rhs) { return lhs.when_ < rhs.when_; });
+    const auto ready {std::upper_bound(merged_.begin(), merged_.end(), watermark,
+                                       [] (const timePoint& when, const stagedValue& staged) { return when < staged.when_; })};
+    for (auto it {merged_.begin()}; it != ready; ++it) {
+      history_.setValueAt(it->value_, it->when_);
+    }
+    const auto count {static_cast<size_t>(ready - merged_.begin())};
+    merged_.erase(merged_.begin(), ready);
+    return count;
+  }
+};  // class memvarMultiProducer
+}  // namespace memvar
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const memvar::memvarConcurrent<T>& mvc) {
+  return os << mvc();
+}
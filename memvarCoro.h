@@ -0,0 +1,290 @@
+//
+// memvarCoro.h
+//
+#pragma once
+
+#include "memvar.h"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <utility>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+class eventLoop;
+
+// task
+// a coroutine run by an eventLoop; it starts suspended and it runs when it
+// is spawned on a loop, that owns it until it completes
+class task {
+ public:
+  struct promise_type {
+    eventLoop* loop_ {nullptr};
+    // where the task is in the tasks of its loop
+    size_t index_ {0};
+    std::exception_ptr exception_ {};
+
+    struct finalAwaiter {
+      bool await_ready() const noexcept {
+        return false;
+      }
+      void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept;
+      void await_resume() const noexcept {}
+    };
+
+    task get_return_object() noexcept {
+      return task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() const noexcept {
+      return {};
+    }
+    finalAwaiter final_suspend() const noexcept {
+      return {};
+    }
+    void return_void() const noexcept {}
+    void unhandled_exception() noexcept {
+      exception_ = std::current_exception();
+    }
+  };
+
+  task(const task& rhs) = delete;
+  task& operator=(const task& rhs) = delete;
+
+  task(task&& rhs) noexcept :
+  handle_ (std::exchange(rhs.handle_, {}))
+  {}
+
+  task& operator=(task&& rhs) noexcept {
+    if ( this != &rhs ) {
+      destroy();
+      handle_ = std::exchange(rhs.handle_, {});
+    }
+    return *this;
+  }
+
+  ~task() {
+    destroy();
+  }
+
+ private:
+  friend class eventLoop;
+
+  std::coroutine_handle<promise_type> handle_ {};
+
+  explicit task(std::coroutine_handle<promise_type> handle) noexcept :
+  handle_ (handle)
+  {}
+
+  void destroy() noexcept {
+    if ( handle_ ) {
+      handle_.destroy();
+      handle_ = {};
+    }
+  }
+};  // class task
+
+// eventLoop
+// a single-threaded loop resuming the coroutines that are ready to go on,
+// e.g. the ones waiting on memvar updates once a value is written; the
+// memvars must be written on the thread running the loop
+class eventLoop {
+ public:
+  eventLoop() = default;
+
+  eventLoop(const eventLoop& rhs) = delete;
+  eventLoop& operator=(const eventLoop& rhs) = delete;
+
+  ~eventLoop() {
+    for (auto handle : tasks_) {
+      handle.destroy();
+    }
+  }
+
+  // schedule a suspended coroutine to be resumed by run()
+  void post(const std::coroutine_handle<> handle) {
+    ready_.push_back(handle);
+  }
+
+  // start a task on the loop: it runs at the next run()
+  void spawn(task&& t) {
+    auto handle {std::exchange(t.handle_, {})};
+    handle.promise().loop_ = this;
+    handle.promise().index_ = tasks_.size();
+    tasks_.push_back(handle);
+    post(handle);
+  }
+
+  // resume the ready coroutines until none is left, destroying the tasks
+  // that complete; an exception escaping a task is rethrown here
+  // returns the number of coroutines resumed
+  size_t run() {
+    size_t resumed {0};
+    while ( !ready_.empty() ) {
+      const auto handle {ready_.front()};
+      ready_.pop_front();
+      handle.resume();
+      ++resumed;
+      reapFinished();
+    }
+    return resumed;
+  }
+
+  // the number of tasks not completed yet
+  size_t getTaskCount() const noexcept {
+    return tasks_.size();
+  }
+
+ private:
+  friend struct task::promise_type::finalAwaiter;
+
+  std::deque<std::coroutine_handle<>> ready_ {};
+  std::vector<std::coroutine_handle<task::promise_type>> tasks_ {};
+  std::vector<std::coroutine_handle<task::promise_type>> finished_ {};
+
+  void reapFinished() {
+    std::exception_ptr exception {};
+    for (auto handle : finished_) {
+      if ( handle.promise().exception_ && !exception ) {
+        exception = handle.promise().exception_;
+      }
+      // the last task takes the place of the finished one
+      const auto index {handle.promise().index_};
+      tasks_[index] = tasks_.back();
+      tasks_[index].promise().index_ = index;
+      tasks_.pop_back();
+      handle.destroy();
+    }
+    finished_.clear();
+    if ( exception ) {
+      std::rethrow_exception(exception);
+    }
+  }
+};  // class eventLoop
+
+inline void task::promise_type::finalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) const noexcept {
+  // the loop destroys the coroutine once it is back in control
+  handle.promise().loop_->finished_.push_back(handle);
+}
+
+// updateStream
+// the values written to a memvar, to be awaited by a coroutine on an
+// eventLoop: co_await stream.next() gives the next value, or std::nullopt
+// once the stream is closed; the values written while the coroutine is
+// busy are queued, and so are all the values of a bulk append
+// the memvar must outlive the stream, or the stream must be closed first
+template <typename T>
+class updateStream {
+ private:
+  struct state {
+    explicit state(eventLoop& loop) :
+    loop_ (loop)
+    {}
+
+    eventLoop& loop_;
+    std::deque<T> pending_ {};
+    memvarBase::sequenceType lastSequence_ {0};
+    std::coroutine_handle<> waiting_ {};
+    bool closed_ {false};
+
+    void wake() {
+      if ( waiting_ ) {
+        loop_.post(std::exchange(waiting_, {}));
+      }
+    }
+  };
+
+  struct nextAwaiter {
+    state& state_;
+
+    bool await_ready() const noexcept {
+      return !state_.pending_.empty() || state_.closed_;
+    }
+    void await_suspend(const std::coroutine_handle<> handle) noexcept {
+      state_.waiting_ = handle;
+    }
+    std::optional<T> await_resume() {
+      if ( state_.pending_.empty() ) {
+        return std::nullopt;
+      }
+      std::optional<T> value {std::move(state_.pending_.front())};
+      state_.pending_.pop_front();
+      return value;
+    }
+  };
+
+ public:
+  updateStream(memvar<T>& mv, eventLoop& loop) :
+  mv_ (&mv),
+  state_ (std::make_shared<state>(loop)) {
+    state_->lastSequence_ = mv.getSequence();
+    id_ = mv.onChange([s = state_, &mv] (const T& value, const memvarBase::sequenceType sequence) {
+      // a bulk append calls back once, with the newest value: the older
+      // values still in the history are queued before it
+      const auto missed {std::min<uint64_t>(sequence - s->lastSequence_ - 1,
+                                            static_cast<uint64_t>(mv.getHistorySize() - 1))};
+      for (auto k {missed}; k > 0; --k) {
+        s->pending_.push_back(mv(static_cast<memvarBase::capacityType>(k)));
+      }
+      s->pending_.push_back(value);
+      s->lastSequence_ = sequence;
+      s->wake();
+    });
+  }
+
+  updateStream(const updateStream& rhs) = delete;
+  updateStream& operator=(const updateStream& rhs) = delete;
+
+  updateStream(updateStream&& rhs) noexcept :
+  mv_ (std::exchange(rhs.mv_, nullptr)),
+  id_ (rhs.id_),
+  state_ (std::move(rhs.state_))
+  {}
+
+  updateStream& operator=(updateStream&& rhs) noexcept {
+    if ( this != &rhs ) {
+      close();
+      mv_ = std::exchange(rhs.mv_, nullptr);
+      id_ = rhs.id_;
+      state_ = std::move(rhs.state_);
+    }
+    return *this;
+  }
+
+  ~updateStream() {
+    close();
+  }
+
+  auto next() noexcept {
+    return nextAwaiter {*state_};
+  }
+
+  // stop receiving values: the values already queued are still given, then
+  // the waiting coroutine gets std::nullopt
+  void close() {
+    if ( nullptr == mv_ ) {
+      return;
+    }
+    mv_->unsubscribe(id_);
+    mv_ = nullptr;
+    state_->closed_ = true;
+    state_->wake();
+  }
+
+  size_t getPendingCount() const noexcept {
+    return state_->pending_.size();
+  }
+
+ private:
+  memvar<T>* mv_ {nullptr};
+  typename memvar<T>::subscriptionId id_ {0};
+  std::shared_ptr<state> state_ {};
+};  // class updateStream
+
+template <typename T>
+updateStream<T> updates(memvar<T>& mv, eventLoop& loop) {
+  return updateStream<T>(mv, loop);
+}
+}  // namespace memvar
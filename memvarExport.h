@@ -0,0 +1,154 @@
+//
+// memvarExport.h
+//
+#pragma once
+
+#include "memvar.h"
+#include <fstream>
+#include <system_error>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// The text formats of an exported history
+enum class exportFormat {
+  bracket,   // as printed by printHistoryData() and printHistoryTimedData()
+  csv,       // a header line, then a line per value
+  jsonLines  // a JSON object per line
+};
+
+namespace detail
+{
+// call f with the items of the histories at the same positions, in the
+// given order
+template <typename F, typename... Histories>
+void forEachHistoryItem(const historyOrder order, F&& f, const Histories&... histories) {
+  if ( historyOrder::oldestFirst == order ) {
+    std::tuple its {histories.crbegin()...};
+    for (auto i {std::min({histories.size()...})}; i > 0; --i) {
+      std::apply([&f] (auto&... it) { f(*it++...); }, its);
+    }
+  }
+  else {
+    std::tuple its {histories.cbegin()...};
+    for (auto i {std::min({histories.size()...})}; i > 0; --i) {
+      std::apply([&f] (auto&... it) { f(*it++...); }, its);
+    }
+  }
+}
+}  // namespace detail
+
+// write the history of mv to out in the given format and order
+template <typename T>
+void exportHistory(textWriter& out,
+                   const memvar<T>& mv,
+                   const exportFormat format,
+                   const historyOrder order = historyOrder::newestFirst) {
+  const auto& history {mv.getMemVarHistory()};
+  switch ( format ) {
+    case exportFormat::bracket:
+      out.write("[ ");
+      detail::forEachHistoryItem(order, [&out] (const T& value) {
+        out.writeValue(value);
+        out.put(' ');
+      }, history);
+      out.write("]\n");
+      break;
+    case exportFormat::csv:
+      out.write("value\n");
+      detail::forEachHistoryItem(order, [&out] (const T& value) {
+        out.writeValue(value, textEscape::csv);
+        out.put('\n');
+      }, history);
+      break;
+    case exportFormat::jsonLines:
+      detail::forEachHistoryItem(order, [&out] (const T& value) {
+        out.write("{\"value\":");
+        out.writeValue(value, textEscape::json);
+        out.write("}\n");
+      }, history);
+      break;
+  }
+}
+
+// write the history of mvt with its time tags
+template <typename T, typename Time, typename Clock>
+void exportHistory(textWriter& out,
+                   const memvarTimed<T, Time, Clock>& mvt,
+                   const exportFormat format,
+                   const historyOrder order = historyOrder::newestFirst) {
+  const auto& history {mvt.getMemVarHistory()};
+  const auto& timeHistory {mvt.getTimeHistory()};
+  const auto epoch {mvt.getTimePoint() - mvt.getTimeTag()};
+  auto timeTag = [&epoch] (const auto& when) {
+    return std::chrono::duration_cast<Time>(when - epoch).count();
+  };
+  switch ( format ) {
+    case exportFormat::bracket:
+      out.write("{ --- begin ---\n[TimeTag:Value]\n");
+      detail::forEachHistoryItem(order, [&out, &timeTag] (const T& value, const auto& when) {
+        out.put('[');
+        out.writeValue(timeTag(when));
+        out.put(':');
+        out.writeValue(value);
+        out.write("]\n");
+      }, history, timeHistory);
+      out.write("  --- end --- }\n\n");
+      break;
+    case exportFormat::csv:
+      out.write("timeTag,value\n");
+      detail::forEachHistoryItem(order, [&out, &timeTag] (const T& value, const auto& when) {
+        out.writeValue(timeTag(when));
+        out.put(',');
+        out.writeValue(value, textEscape::csv);
+        out.put('\n');
+      }, history, timeHistory);
+      break;
+    case exportFormat::jsonLines:
+      detail::forEachHistoryItem(order, [&out, &timeTag] (const T& value, const auto& when) {
+        out.write("{\"timeTag\":");
+        out.writeValue(timeTag(when));
+        out.write(",\"value\":");
+        out.writeValue(value, textEscape::json);
+        out.write("}\n");
+      }, history, timeHistory);
+      break;
+  }
+}
+
+template <typename Memvar>
+void exportHistory(std::ostream& os,
+                   const Memvar& mv,
+                   const exportFormat format,
+                   const historyOrder order = historyOrder::newestFirst) {
+  textWriter out {os};
+  exportHistory(out, mv, format, order);
+}
+
+// write the history to the file at path, replacing it
+template <typename Memvar>
+void exportHistory(const std::string& path,
+                   const Memvar& mv,
+                   const exportFormat format,
+                   const historyOrder order = historyOrder::newestFirst) {
+  std::FILE* file {std::fopen(path.c_str(), "wb")};
+  if ( nullptr == file ) {
+    throw std::system_error(errno, std::generic_category(), "fopen " + path);
+  }
+  try {
+    textWriter out {file, 0, 1 << 20};
+    exportHistory(out, mv, format, order);
+    out.flush();
+  }
+  catch (const std::system_error& e) {
+    std::fclose(file);
+    throw std::system_error(e.code(), "write " + path);
+  }
+  catch (...) {
+    std::fclose(file);
+    throw;
+  }
+  if ( 0 != std::fclose(file) ) {
+    throw std::system_error(errno, std::generic_category(), "fclose " + path);
+  }
+}
+}  // namespace memvar
@@ -0,0 +1,474 @@
+//
+// memvarFile.h
+//
+#pragma once
+
+#include "memvar.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+namespace detail
+{
+// the layout of a memvar history file:
+// - a header: what the values are, the history capacity, the unit of the
+//   time tags, the time point epoch and the size of the history
+// - the value column, oldest value first: the values packed if trivially
+//   copyable, else each string preceded by its length
+// - the time tag column, for a memvarTimed: the time tags, in Time units
+//   from the epoch, of the values in the same order
+// the columns start at multiples of historyFileAlignment, so that a mapped
+// file can be read in place
+struct historyFileHeader {
+  static constexpr uint64_t magic {0x6d656d7668697301};
+  static constexpr uint32_t version {2};
+
+  enum class valueKind : uint32_t {
+    unsignedIntegral,
+    signedIntegral,
+    floatingPoint,
+    string,
+    trivial  // any other trivially copyable type
+  };
+
+  uint64_t magic_ {magic};
+  uint32_t version_ {version};
+  valueKind kind_ {valueKind::trivial};
+  // the size of a value, or of a character for the strings
+  uint32_t valueSize_ {0};
+  // 0 if there are no time tags
+  uint32_t timeSize_ {0};
+  // the time tag unit: Time::period, 0/0 if there are no time tags
+  int64_t periodNum_ {0};
+  int64_t periodDen_ {0};
+  int64_t historyCapacity_ {0};
+  // the time point epoch in Time units from the epoch of the clock
+  int64_t epoch_ {0};
+  uint64_t historySize_ {0};
+  uint64_t valuesOffset_ {0};
+  uint64_t valuesBytes_ {0};
+  uint64_t timeTagsOffset_ {0};
+};
+
+inline constexpr uint64_t historyFileAlignment {64};
+
+inline constexpr uint64_t alignHistoryFile(const uint64_t offset) noexcept {
+  return (offset + historyFileAlignment - 1) / historyFileAlignment * historyFileAlignment;
+}
+
+// the time fields of the header of a history timed in Time units
+template <typename Time>
+void setHistoryFileTime(historyFileHeader& header) noexcept {
+  header.timeSize_ = sizeof(typename Time::rep);
+  header.periodNum_ = static_cast<int64_t>(Time::period::num);
+  header.periodDen_ = static_cast<int64_t>(Time::period::den);
+}
+
+// if count elements of elementSize bytes from offset, a multiple of
+// alignment, are all in a file of size bytes
+inline bool historyFileSectionFits(const uint64_t offset,
+                                   const uint64_t count,
+                                   const uint64_t elementSize,
+                                   const uint64_t alignment,
+                                   const uint64_t size) noexcept {
+  return (0 == offset % alignment) && (offset <= size) && (count <= (size - offset) / elementSize);
+}
+
+template <typename T>
+concept historyFileValue = std::is_trivially_copyable_v<T> || AnyStandardString<T>;
+
+template <typename T>
+constexpr historyFileHeader::valueKind historyValueKind() noexcept {
+  if constexpr ( AnyStandardString<T> ) {
+    return historyFileHeader::valueKind::string;
+  }
+  else if constexpr ( std::is_floating_point_v<T> ) {
+    return historyFileHeader::valueKind::floatingPoint;
+  }
+  else if constexpr ( std::is_integral_v<T> && std::is_signed_v<T> ) {
+    return historyFileHeader::valueKind::signedIntegral;
+  }
+  else if constexpr ( std::is_integral_v<T> ) {
+    return historyFileHeader::valueKind::unsignedIntegral;
+  }
+  else {
+    return historyFileHeader::valueKind::trivial;
+  }
+}
+
+template <typename T>
+constexpr uint32_t historyValueSize() noexcept {
+  if constexpr ( AnyStandardString<T> ) {
+    return sizeof(typename T::value_type);
+  }
+  else {
+    return sizeof(T);
+  }
+}
+
+// the time fields of expected are checked if its timeSize_ is not 0
+template <typename T>
+void checkHistoryFileHeader(const historyFileHeader& header, const historyFileHeader& expected, const std::string& path) {
+  if ( (historyFileHeader::magic != header.magic_) || (historyFileHeader::version != header.version_) ) {
+    throw std::runtime_error("memvar history file: " + path + " is not a memvar history file, or its version is not supported");
+  }
+  if ( (historyValueKind<T>() != header.kind_) ||
+       (historyValueSize<T>() != header.valueSize_) ||
+       ((0 != expected.timeSize_) && ((expected.timeSize_ != header.timeSize_) ||
+                                      (expected.periodNum_ != header.periodNum_) ||
+                                      (expected.periodDen_ != header.periodDen_))) ) {
+    throw std::invalid_argument("memvar history file: " + path + " does not match the value or time types");
+  }
+}
+
+// the values of history, oldest first
+template <typename T>
+void writeHistoryValues(std::ostream& os, const std::deque<T>& history) {
+  if constexpr ( AnyStandardString<T> ) {
+    for (auto it {history.crbegin()}; it != history.crend(); ++it) {
+      const uint64_t length {it->size()};
+      os.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      os.write(reinterpret_cast<const char*>(it->data()), static_cast<std::streamsize>(length * sizeof(typename T::value_type)));
+    }
+  }
+  else {
+    // copied out of the deque in chunks, to write many values at a time
+    std::vector<T> chunk (std::min<size_t>(history.size(), 65'536));
+    auto it {history.crbegin()};
+    while ( it != history.crend() ) {
+      const auto count {std::min<size_t>(chunk.size(), static_cast<size_t>(history.crend() - it))};
+      std::copy_n(it, count, chunk.begin());
+      os.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(count * sizeof(T)));
+      it += static_cast<std::ptrdiff_t>(count);
+    }
+  }
+}
+
+template <typename T>
+uint64_t historyValuesBytes(const std::deque<T>& history) noexcept {
+  if constexpr ( AnyStandardString<T> ) {
+    uint64_t bytes {0};
+    for (const auto& value : history) {
+      bytes += sizeof(uint64_t) + value.size() * sizeof(typename T::value_type);
+    }
+    return bytes;
+  }
+  else {
+    return history.size() * sizeof(T);
+  }
+}
+
+inline void padHistoryFile(std::ostream& os, const uint64_t from, const uint64_t to) {
+  static constexpr char zeros[historyFileAlignment] {};
+  os.write(zeros, static_cast<std::streamsize>(to - from));
+}
+
+template <typename T>
+void writeHistoryFile(const std::string& path,
+                      historyFileHeader header,
+                      const std::deque<T>& history,
+                      const std::vector<int64_t>& timeTags) {
+  header.kind_ = historyValueKind<T>();
+  header.valueSize_ = historyValueSize<T>();
+  header.historySize_ = history.size();
+  header.valuesOffset_ = alignHistoryFile(sizeof(historyFileHeader));
+  header.valuesBytes_ = historyValuesBytes(history);
+  header.timeTagsOffset_ = alignHistoryFile(header.valuesOffset_ + header.valuesBytes_);
+
+  std::ofstream os {path, std::ios::binary | std::ios::trunc};
+  if ( !os ) {
+    throw std::system_error(errno, std::generic_category(), "open " + path);
+  }
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  padHistoryFile(os, sizeof(header), header.valuesOffset_);
+  writeHistoryValues(os, history);
+  if ( 0 != header.timeSize_ ) {
+    padHistoryFile(os, header.valuesOffset_ + header.valuesBytes_, header.timeTagsOffset_);
+    os.write(reinterpret_cast<const char*>(timeTags.data()), static_cast<std::streamsize>(timeTags.size() * sizeof(int64_t)));
+  }
+  os.flush();
+  if ( !os ) {
+    throw std::system_error(errno, std::generic_category(), "write " + path);
+  }
+}
+
+// read the file at path: the values and time tags are handed to f(header,
+// value, timeTag), oldest first
+template <typename T, typename F>
+historyFileHeader readHistoryFile(const std::string& path, const historyFileHeader& expected, F&& f) {
+  std::ifstream is {path, std::ios::binary};
+  if ( !is ) {
+    throw std::system_error(errno, std::generic_category(), "open " + path);
+  }
+  historyFileHeader header {};
+  is.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if ( !is ) {
+    throw std::runtime_error("memvar history file: " + path + " is not a memvar history file");
+  }
+  checkHistoryFileHeader<T>(header, expected, path);
+
+  // the sizes in the header are checked against the file before anything is
+  // allocated from them; a string takes its length at least
+  is.seekg(0, std::ios::end);
+  const auto size {static_cast<uint64_t>(is.tellg())};
+  const auto truncated = [&path] () {
+    return std::runtime_error("memvar history file: " + path + " is truncated");
+  };
+  constexpr uint64_t valueBytes {AnyStandardString<T> ? sizeof(uint64_t) : sizeof(T)};
+  if ( !historyFileSectionFits(header.valuesOffset_, header.historySize_, valueBytes, 1, size) ||
+       ((0 != header.timeSize_) &&
+        !historyFileSectionFits(header.timeTagsOffset_, header.historySize_, sizeof(int64_t), 1, size)) ) {
+    throw truncated();
+  }
+
+  std::vector<int64_t> timeTags (0 == header.timeSize_ ? 0 : header.historySize_);
+  if ( !timeTags.empty() ) {
+    is.seekg(static_cast<std::streamoff>(header.timeTagsOffset_));
+    is.read(reinterpret_cast<char*>(timeTags.data()), static_cast<std::streamsize>(timeTags.size() * sizeof(int64_t)));
+    if ( !is ) {
+      throw truncated();
+    }
+  }
+  is.seekg(static_cast<std::streamoff>(header.valuesOffset_));
+  T value {};
+  for (uint64_t i {0}; i < header.historySize_; ++i) {
+    if constexpr ( AnyStandardString<T> ) {
+      uint64_t length {0};
+      is.read(reinterpret_cast<char*>(&length), sizeof(length));
+      if ( !is || (length > (size - static_cast<uint64_t>(is.tellg())) / sizeof(typename T::value_type)) ) {
+        throw truncated();
+      }
+      value.resize(static_cast<size_t>(length));
+      is.read(reinterpret_cast<char*>(value.data()), static_cast<std::streamsize>(length * sizeof(typename T::value_type)));
+    }
+    else {
+      is.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+    if ( !is ) {
+      throw truncated();
+    }
+    f(std::as_const(header), std::as_const(value), timeTags.empty() ? 0 : timeTags[i]);
+  }
+  return header;
+}
+}  // namespace detail
+
+// save the history of mv to the file at path, replacing it
+// only trivially copyable and string types allowed
+template <typename T>
+  requires detail::historyFileValue<T>
+void saveHistory(const std::string& path, const memvar<T>& mv) {
+  detail::historyFileHeader header {};
+  header.historyCapacity_ = mv.getHistoryCapacity();
+  detail::writeHistoryFile(path, header, mv.getMemVarHistory(), {});
+}
+
+// save the history of mvt, with its time tags and epoch
+template <typename T, typename Time, typename Clock>
+  requires detail::historyFileValue<T>
+void saveHistory(const std::string& path, const memvarTimed<T, Time, Clock>& mvt) {
+  static_assert(sizeof(typename Time::rep) == sizeof(int64_t), "64-bit time tags required.");
+  detail::historyFileHeader header {};
+  header.historyCapacity_ = mvt.getHistoryCapacity();
+  detail::setHistoryFileTime<Time>(header);
+  header.epoch_ = (mvt.getTimePoint() - mvt.getTimeTag()).time_since_epoch().count();
+  std::vector<int64_t> timeTags (static_cast<size_t>(mvt.getHistorySize()));
+  for (size_t i {0}; i < timeTags.size(); ++i) {
+    timeTags[timeTags.size() - 1 - i] = mvt.getTimeTag(i).count();
+  }
+  detail::writeHistoryFile(path, header, mvt.getMemVarHistory(), timeTags);
+}
+
+// append the history saved at path to the history of mv
+// returns the number of values in the file
+template <typename T>
+  requires detail::historyFileValue<T>
+uint64_t loadHistory(const std::string& path, memvar<T>& mv) {
+  std::vector<T> values {};
+  const auto header {detail::readHistoryFile<T>(path, {}, [&values] (const detail::historyFileHeader&, const T& value, int64_t) {
+    values.push_back(value);
+  })};
+  mv.append(values.cbegin(), values.cend());
+  return header.historySize_;
+}
+
+// store the history saved at path in mvt, each value with its time point
+// returns the number of values in the file
+template <typename T, typename Time, typename Clock>
+  requires detail::historyFileValue<T>
+uint64_t loadHistory(const std::string& path, memvarTimed<T, Time, Clock>& mvt) {
+  using timePoint = typename memvarTimed<T, Time, Clock>::timePoint;
+  detail::historyFileHeader expected {};
+  detail::setHistoryFileTime<Time>(expected);
+  const auto header {detail::readHistoryFile<T>(path, expected,
+    [&mvt] (const detail::historyFileHeader& fileHeader, const T& value, const int64_t timeTag) {
+      mvt.setValueAt(value, timePoint(Time(fileHeader.epoch_ + timeTag)));
+    })};
+  return header.historySize_;
+}
+
+// mappedHistory
+// a read-only history loaded from a file saved by saveHistory(), mapped in
+// memory and read in place: loading it costs the same whatever the size of
+// the history, the pages are read from the file when first accessed
+// the indexes count back from the newest value, as in a memvar
+// only trivially copyable types allowed
+template <typename T, typename Time = std::chrono::nanoseconds>
+class mappedHistory {
+ public:
+  using historyValue = std::tuple<T, bool>;
+
+  explicit mappedHistory(const std::string& path) {
+    static_assert(std::is_trivially_copyable_v<T>, "Trivially copyable type required.");
+    const int fd {::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if ( -1 == fd ) {
+      throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+    struct stat status {};
+    if ( -1 == ::fstat(fd, &status) ) {
+      const auto error {errno};
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "fstat " + path);
+    }
+    size_ = static_cast<size_t>(status.st_size);
+    if ( size_ < sizeof(detail::historyFileHeader) ) {
+      ::close(fd);
+      throw std::runtime_error("memvar history file: " + path + " is not a memvar history file");
+    }
+    address_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    const auto error {errno};
+    ::close(fd);
+    if ( MAP_FAILED == address_ ) {
+      address_ = nullptr;
+      throw std::system_error(error, std::generic_category(), "mmap " + path);
+    }
+
+    const auto* bytes {static_cast<const std::byte*>(address_)};
+    std::memcpy(&header_, bytes, sizeof(header_));
+    try {
+      // the time tags, if any, must be in Time units
+      detail::historyFileHeader expected {};
+      if ( 0 != header_.timeSize_ ) {
+        detail::setHistoryFileTime<Time>(expected);
+      }
+      detail::checkHistoryFileHeader<T>(header_, expected, path);
+      // the columns are read in place: they must be in the file, and aligned
+      if ( !detail::historyFileSectionFits(header_.valuesOffset_, header_.historySize_, sizeof(T), alignof(T), size_) ||
+           (header_.valuesOffset_ < sizeof(detail::historyFileHeader)) ||
+           (header_.valuesBytes_ != header_.historySize_ * sizeof(T)) ||
+           ((0 != header_.timeSize_) &&
+            !detail::historyFileSectionFits(header_.timeTagsOffset_, header_.historySize_, header_.timeSize_,
+                                            alignof(typename Time::rep), size_)) ) {
+        throw std::runtime_error("memvar history file: " + path + " is truncated or corrupted");
+      }
+    }
+    catch (...) {
+      unmap();
+      throw;
+    }
+    values_ = std::launder(reinterpret_cast<const T*>(bytes + header_.valuesOffset_));
+    if ( 0 != header_.timeSize_ ) {
+      timeTags_ = std::launder(reinterpret_cast<const typename Time::rep*>(bytes + header_.timeTagsOffset_));
+    }
+  }
+
+  mappedHistory(const mappedHistory& rhs) = delete;
+  mappedHistory& operator=(const mappedHistory& rhs) = delete;
+
+  mappedHistory(mappedHistory&& rhs) noexcept :
+  address_ (std::exchange(rhs.address_, nullptr)),
+  size_ (rhs.size_),
+  header_ (rhs.header_),
+  values_ (rhs.values_),
+  timeTags_ (rhs.timeTags_)
+  {}
+
+  mappedHistory& operator=(mappedHistory&& rhs) noexcept {
+    if ( this != &rhs ) {
+      unmap();
+      address_ = std::exchange(rhs.address_, nullptr);
+      size_ = rhs.size_;
+      header_ = rhs.header_;
+      values_ = rhs.values_;
+      timeTags_ = rhs.timeTags_;
+    }
+    return *this;
+  }
+
+  ~mappedHistory() {
+    unmap();
+  }
+
+  T operator()() const {
+    return (*this)(0);
+  }
+
+  T operator()(const memvarBase::capacityType index) const {
+    return std::get<T>(getHistoryValue(index));
+  }
+
+  auto getHistoryValue(const memvarBase::capacityType index) const noexcept -> historyValue {
+    if ( (index < getHistorySize()) && (index >= 0) ) {
+      return std::make_tuple(values_[header_.historySize_ - 1 - static_cast<uint64_t>(index)], false);
+    }
+    return std::make_tuple(T{}, true);
+  }
+
+  // the time tag of the i-th value, in Time units from the epoch
+  Time getTimeTag(const memvarBase::capacityType index = 0) const {
+    if ( !isTimed() || (index < 0) || (index >= getHistorySize()) ) {
+      throw std::out_of_range("mappedHistory: no time tag at this index");
+    }
+    return Time(timeTags_[header_.historySize_ - 1 - static_cast<uint64_t>(index)]);
+  }
+
+  // the time point epoch of the saved memvarTimed, in Time units from the
+  // epoch of its clock
+  Time getEpoch() const noexcept {
+    return Time(header_.epoch_);
+  }
+
+  bool isTimed() const noexcept {
+    return nullptr != timeTags_;
+  }
+
+  memvarBase::capacityType getHistorySize() const noexcept {
+    return static_cast<memvarBase::capacityType>(header_.historySize_);
+  }
+
+  memvarBase::capacityType getHistoryCapacity() const noexcept {
+    return header_.historyCapacity_;
+  }
+
+  // the values in place, oldest first
+  std::span<const T> getValues() const noexcept {
+    return {values_, static_cast<size_t>(header_.historySize_)};
+  }
+
+  // the time tags in place, oldest first; empty if not timed
+  std::span<const typename Time::rep> getTimeTags() const noexcept {
+    return {timeTags_, isTimed() ? static_cast<size_t>(header_.historySize_) : 0};
+  }
+
+ private:
+  void* address_ {nullptr};
+  size_t size_ {0};
+  detail::historyFileHeader header_ {};
+  const T* values_ {nullptr};
+  const typename Time::rep* timeTags_ {nullptr};
+
+  void unmap() noexcept {
+    if ( nullptr != address_ ) {
+      ::munmap(address_, size_);
+      address_ = nullptr;
+    }
+  }
+};  // class mappedHistory
+}  // namespace memvar
@@ -0,0 +1,629 @@
+//
+// memvarLog.h
+//
+#pragma once
+
+#include "memvarConcurrent.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <system_error>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+namespace detail
+{
+// the layout of a memvar log: a header, then fixed size records appended in
+// the order the values were written
+// a record is: marker, checksum, sequence number, time point, value; the
+// end of the log is the first record whose marker or checksum is wrong,
+// that is the zero padding of the last block, or a record torn by a crash
+struct logHeader {
+  static constexpr uint64_t magic {0x6d656d766c6f6701};
+  static constexpr uint32_t version {2};
+
+  uint64_t magic_ {magic};
+  uint32_t version_ {version};
+  uint32_t valueSize_ {0};
+  uint32_t timeSize_ {0};
+  uint32_t recordSize_ {0};
+  // the time point unit: Time::period
+  int64_t periodNum_ {0};
+  int64_t periodDen_ {0};
+};
+
+inline constexpr uint32_t logRecordMarker {0x4d564c52};
+
+// a value as logged: the time point is counted in Time units from the epoch
+// of the clock
+template <typename T, typename Time>
+struct logEntry {
+  uint64_t sequence_ {0};
+  typename Time::rep timePoint_ {0};
+  T value_ {};
+};
+
+template <typename T, typename Time>
+inline constexpr size_t logRecordSize {2 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(typename Time::rep) + sizeof(T)};
+
+// FNV-1a
+inline uint32_t logChecksum(const std::byte* data, const size_t size) noexcept {
+  uint32_t hash {2'166'136'261U};
+  for (size_t i {0}; i < size; ++i) {
+    hash ^= static_cast<uint32_t>(data[i]);
+    hash *= 16'777'619U;
+  }
+  return hash;
+}
+
+template <typename T, typename Time>
+void encodeLogRecord(std::byte* out, const logEntry<T, Time>& entry) noexcept {
+  auto* payload {out + 2 * sizeof(uint32_t)};
+  std::memcpy(payload, &entry.sequence_, sizeof(uint64_t));
+  std::memcpy(payload + sizeof(uint64_t), &entry.timePoint_, sizeof(typename Time::rep));
+  std::memcpy(payload + sizeof(uint64_t) + sizeof(typename Time::rep), &entry.value_, sizeof(T));
+  const auto checksum {logChecksum(payload, logRecordSize<T, Time> - 2 * sizeof(uint32_t))};
+  std::memcpy(out, &logRecordMarker, sizeof(uint32_t));
+  std::memcpy(out + sizeof(uint32_t), &checksum, sizeof(uint32_t));
+}
+
+// returns false at the end of the log
+template <typename T, typename Time>
+bool decodeLogRecord(const std::byte* in, logEntry<T, Time>& entry) noexcept {
+  uint32_t marker {0};
+  uint32_t checksum {0};
+  std::memcpy(&marker, in, sizeof(uint32_t));
+  std::memcpy(&checksum, in + sizeof(uint32_t), sizeof(uint32_t));
+  const auto* payload {in + 2 * sizeof(uint32_t)};
+  if ( (logRecordMarker != marker) ||
+       (logChecksum(payload, logRecordSize<T, Time> - 2 * sizeof(uint32_t)) != checksum) ) {
+    return false;
+  }
+  std::memcpy(&entry.sequence_, payload, sizeof(uint64_t));
+  std::memcpy(&entry.timePoint_, payload + sizeof(uint64_t), sizeof(typename Time::rep));
+  std::memcpy(&entry.value_, payload + sizeof(uint64_t) + sizeof(typename Time::rep), sizeof(T));
+  return true;
+}
+
+template <typename T, typename Time>
+logHeader makeLogHeader() noexcept {
+  logHeader header {};
+  header.valueSize_ = sizeof(T);
+  header.timeSize_ = sizeof(typename Time::rep);
+  header.recordSize_ = logRecordSize<T, Time>;
+  header.periodNum_ = static_cast<int64_t>(Time::period::num);
+  header.periodDen_ = static_cast<int64_t>(Time::period::den);
+  return header;
+}
+
+[[noreturn]] inline void throwLogError(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+struct logScan {
+  // the size of the valid part of the log: the header and the records
+  uint64_t end_ {0};
+  uint64_t records_ {0};
+  uint64_t lastSequence_ {0};
+};
+
+// call f with each record of the log, oldest first; a missing or empty log
+// has no records
+template <typename T, typename Time, typename F>
+logScan scanLog(const std::string& path, F&& f) {
+  logScan scan {};
+  const int fd {::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+  if ( -1 == fd ) {
+    if ( ENOENT == errno ) {
+      return scan;
+    }
+    throwLogError("open " + path);
+  }
+  struct closer {
+    int fd_;
+    ~closer() {
+      ::close(fd_);
+    }
+  } guard {fd};
+
+  logHeader header {};
+  const auto headerRead {::pread(fd, &header, sizeof(header), 0)};
+  if ( 0 == headerRead ) {
+    return scan;
+  }
+  if ( (headerRead != static_cast<ssize_t>(sizeof(header))) || (logHeader::magic != header.magic_) ) {
+    throw std::runtime_error("memvar log: " + path + " is not a memvar log");
+  }
+  const auto expected {makeLogHeader<T, Time>()};
+  if ( (expected.version_ != header.version_) ||
+       (expected.valueSize_ != header.valueSize_) ||
+       (expected.timeSize_ != header.timeSize_) ||
+       (expected.recordSize_ != header.recordSize_) ||
+       (expected.periodNum_ != header.periodNum_) ||
+       (expected.periodDen_ != header.periodDen_) ) {
+    throw std::invalid_argument("memvar log: " + path + " does not match the value or time types");
+  }
+
+  constexpr auto recordSize {logRecordSize<T, Time>};
+  std::vector<std::byte> buffer ((1 << 20) / recordSize * recordSize + recordSize);
+  logEntry<T, Time> entry {};
+  scan.end_ = sizeof(header);
+  while ( true ) {
+    const auto bytes {::pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(scan.end_))};
+    if ( -1 == bytes ) {
+      throwLogError("read " + path);
+    }
+    const auto records {static_cast<size_t>(bytes) / recordSize};
+    for (size_t i {0}; i < records; ++i) {
+      if ( !decodeLogRecord(buffer.data() + i * recordSize, entry) ) {
+        return scan;
+      }
+      f(std::as_const(entry));
+      scan.end_ += recordSize;
+      ++scan.records_;
+      scan.lastSequence_ = entry.sequence_;
+    }
+    if ( static_cast<size_t>(bytes) < buffer.size() ) {
+      return scan;
+    }
+  }
+}
+
+// logFile
+// the records appended to a memvar log, written in whole blocks: through
+// O_DIRECT, bypassing the page cache, where the file system supports it
+// the last block, partially filled, is written again by the next flush
+template <typename T, typename Time>
+class logFile {
+ public:
+  static constexpr size_t blockSize_ {4'096};
+  static constexpr size_t recordSize_ {logRecordSize<T, Time>};
+
+  logFile(const std::string& path, const size_t bufferSize) :
+  path_ (path) {
+    // the records after the last valid one are overwritten
+    const auto scan {scanLog<T, Time>(path, [] (const logEntry<T, Time>&) {})};
+    lastSequence_ = scan.lastSequence_;
+    records_ = scan.records_;
+
+    capacity_ = roundUp(bufferSize + recordSize_ + blockSize_);
+    buffer_.reset(static_cast<std::byte*>(std::aligned_alloc(blockSize_, capacity_)));
+    if ( nullptr == buffer_ ) {
+      throw std::bad_alloc();
+    }
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT, 0644);
+    if ( (-1 == fd_) && (EINVAL == errno) ) {
+      fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+    if ( -1 == fd_ ) {
+      throwLogError("open " + path);
+    }
+
+    if ( 0 == scan.end_ ) {
+      const auto header {makeLogHeader<T, Time>()};
+      std::memcpy(buffer_.get(), &header, sizeof(header));
+      used_ = sizeof(header);
+      return;
+    }
+    // reload the last block, to go on appending to it
+    fileOffset_ = scan.end_ / blockSize_ * blockSize_;
+    used_ = static_cast<size_t>(scan.end_ - fileOffset_);
+    if ( used_ > 0 ) {
+      readTail();
+    }
+    flushed_ = used_;
+    // cut off a torn record and the stale ones after it before appending, so
+    // that a crash before the next flush cannot leave a valid looking stale
+    // record right after the last one written
+    if ( -1 == ::ftruncate(fd_, static_cast<off_t>(scan.end_)) ) {
+      throwLogError("ftruncate " + path);
+    }
+    sync();
+  }
+
+  logFile(const logFile& rhs) = delete;
+  logFile& operator=(const logFile& rhs) = delete;
+
+  ~logFile() {
+    try {
+      flush();
+      // drop the zero padding of the last block
+      [[maybe_unused]] const auto result {::ftruncate(fd_, static_cast<off_t>(size()))};
+    }
+    catch (...) {
+    }
+    ::close(fd_);
+  }
+
+  void append(const logEntry<T, Time>& entry) {
+    if ( used_ + recordSize_ > capacity_ ) {
+      flush();
+    }
+    encodeLogRecord(buffer_.get() + used_, entry);
+    used_ += recordSize_;
+    lastSequence_ = entry.sequence_;
+    ++records_;
+  }
+
+  // write the records appended so far; they are durable after sync()
+  void flush() {
+    if ( used_ == flushed_ ) {
+      return;
+    }
+    const auto padded {roundUp(used_)};
+    std::memset(buffer_.get() + used_, 0, padded - used_);
+    writeAll(padded);
+    // keep the partially filled last block in the buffer
+    const auto full {used_ / blockSize_ * blockSize_};
+    std::memmove(buffer_.get(), buffer_.get() + full, used_ - full);
+    fileOffset_ += full;
+    used_ -= full;
+    flushed_ = used_;
+  }
+
+  void sync() {
+    if ( -1 == ::fdatasync(fd_) ) {
+      throwLogError("fdatasync " + path_);
+    }
+  }
+
+  // the size of the log, the records not flushed yet included
+  uint64_t size() const noexcept {
+    return fileOffset_ + used_;
+  }
+
+  uint64_t getRecordCount() const noexcept {
+    return records_;
+  }
+
+  // the sequence number of the last record, 0 if none
+  uint64_t getLastSequence() const noexcept {
+    return lastSequence_;
+  }
+
+ private:
+  struct freeDeleter {
+    void operator()(std::byte* p) const noexcept {
+      std::free(p);
+    }
+  };
+
+  const std::string path_;
+  int fd_ {-1};
+  std::unique_ptr<std::byte, freeDeleter> buffer_ {};
+  size_t capacity_ {0};
+  // the buffer holds the bytes of the file from fileOffset_, a multiple of
+  // the block size, to fileOffset_ + used_; the first flushed_ of them have
+  // been written
+  uint64_t fileOffset_ {0};
+  size_t used_ {0};
+  size_t flushed_ {0};
+  uint64_t lastSequence_ {0};
+  uint64_t records_ {0};
+
+  static size_t roundUp(const size_t size) noexcept {
+    return (size + blockSize_ - 1) / blockSize_ * blockSize_;
+  }
+
+  // O_DIRECT can be accepted by open() and then refused by the file system
+  // on the first transfer: go on through the page cache then
+  bool dropDirect() noexcept {
+    const int flags {::fcntl(fd_, F_GETFL)};
+    if ( (-1 == flags) || (0 == (flags & O_DIRECT)) ) {
+      return false;
+    }
+    return -1 != ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+  }
+
+  void readTail() {
+    while ( true ) {
+      const auto bytes {::pread(fd_, buffer_.get(), blockSize_, static_cast<off_t>(fileOffset_))};
+      if ( bytes >= static_cast<ssize_t>(used_) ) {
+        return;
+      }
+      if ( !((-1 == bytes) && (EINVAL == errno) && dropDirect()) ) {
+        throwLogError("read " + path_);
+      }
+    }
+  }
+
+  void writeAll(const size_t size) {
+    size_t written {0};
+    while ( written < size ) {
+      const auto bytes {::pwrite(fd_, buffer_.get() + written, size - written, static_cast<off_t>(fileOffset_ + written))};
+      if ( bytes > 0 ) {
+        written += static_cast<size_t>(bytes);
+      }
+      else if ( !((-1 == bytes) && (((EINVAL == errno) && dropDirect()) || (EINTR == errno))) ) {
+        throwLogError("write " + path_);
+      }
+    }
+  }
+};  // class logFile
+}  // namespace detail
+
+// When a memvarPersister makes its log durable with fdatasync(): once
+// records_ values are waiting, or interval_ after the oldest of them was
+// written to the log, whichever comes first; 0 disables either, and the
+// default policy leaves the log to the operating system
+struct logSyncPolicy {
+  uint64_t records_ {0};
+  std::chrono::microseconds interval_ {0};
+};
+
+// memvarPersister
+// streams the values written to a memvarTimed to an append-only binary log,
+// from a background thread
+// the writer thread only copies each value with its time point and sequence
+// number to a lock-free ring: the background thread drains the ring, and
+// writes the records in batches every flush interval; if the ring is full
+// the writer spins until the background thread makes room
+// the values written after the persister is attached are logged, the ones of
+// a bulk append included, as far as they are in the history; the log is
+// replayed by replayLog()
+// with a logSyncPolicy the log is a write-ahead log with group commit: the
+// background thread calls fdatasync() once for all the values written
+// since the last call, and the writer never waits for the disk but in sync()
+// only trivially copyable types allowed
+template <typename T,
+          typename Time = std::chrono::nanoseconds,
+          typename Clock = std::chrono::high_resolution_clock>
+class memvarPersister {
+ public:
+  using memvarType = memvarTimed<T, Time, Clock>;
+
+  static constexpr size_t ringCapacityDefault_ {65'536};
+  static constexpr std::chrono::microseconds flushIntervalDefault_ {1'000};
+
+  memvarPersister(memvarType& mvt,
+                  const std::string& path,
+                  const size_t ringCapacity = ringCapacityDefault_,
+                  const std::chrono::microseconds flushInterval = flushIntervalDefault_,
+                  const logSyncPolicy syncPolicy = {}) :
+  mvt_ (mvt),
+  log_ (path, ringCapacity * detail::logRecordSize<T, Time>),
+  ring_ (ringCapacity),
+  flushInterval_ (flushInterval),
+  syncPolicy_ (syncPolicy) {
+    static_assert(std::is_trivially_copyable_v<T>, "Trivially copyable type required.");
+    lastSequence_ = mvt.getSequence();
+    id_ = mvt.onChange([this] (const T& value, const memvarBase::sequenceType sequence) {
+      enqueue(value, sequence);
+    });
+    flusher_ = std::jthread([this] (std::stop_token stoken) { run(stoken); });
+  }
+
+  memvarPersister(const memvarPersister& rhs) = delete;
+  memvarPersister& operator=(const memvarPersister& rhs) = delete;
+
+  // the values enqueued are written before the log is closed
+  ~memvarPersister() {
+    mvt_.unsubscribe(id_);
+    flusher_.request_stop();
+    flusher_.join();
+  }
+
+  // writer side: block until the values written so far are in the log,
+  // i.e. handed over to the operating system
+  void flush() {
+    const auto target {enqueued_};
+    {
+      std::lock_guard<std::mutex> lock {mtx_};
+      flushRequested_ = true;
+    }
+    cv_.notify_one();
+    auto persisted {persisted_.load(std::memory_order_acquire)};
+    while ( (persisted < target) && !failed_.load(std::memory_order_acquire) ) {
+      persisted_.wait(persisted, std::memory_order_acquire);
+      persisted = persisted_.load(std::memory_order_acquire);
+    }
+    checkError();
+  }
+
+  // writer side: block until the values written so far are durable, i.e.
+  // in the log and synced to the disk
+  void sync() {
+    const auto target {enqueued_};
+    requestSync();
+    auto durable {durable_.load(std::memory_order_acquire)};
+    while ( (durable < target) && !failed_.load(std::memory_order_acquire) ) {
+      durable_.wait(durable, std::memory_order_acquire);
+      durable = durable_.load(std::memory_order_acquire);
+    }
+    checkError();
+  }
+
+  // rethrow the error that stopped the background thread, if any
+  void checkError() const {
+    if ( failed_.load(std::memory_order_acquire) ) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+  // the number of values written to the log
+  uint64_t getPersistedCount() const noexcept {
+    return persisted_.load(std::memory_order_acquire);
+  }
+
+  // the number of values synced to the disk
+  uint64_t getDurableCount() const noexcept {
+    return durable_.load(std::memory_order_acquire);
+  }
+
+  // the number of fdatasync() calls, each making a group of values durable
+  uint64_t getSyncCount() const noexcept {
+    return syncs_.load(std::memory_order_relaxed);
+  }
+
+  // the number of times the writer found the ring full
+  uint64_t getStallCount() const noexcept {
+    return stalls_;
+  }
+
+ private:
+  using entry = detail::logEntry<T, Time>;
+
+  memvarType& mvt_;
+  detail::logFile<T, Time> log_;
+  detail::spscRing<entry> ring_;
+  const std::chrono::microseconds flushInterval_;
+  const logSyncPolicy syncPolicy_;
+  typename memvar<T>::subscriptionId id_ {0};
+  // used by the writer thread only
+  memvarBase::sequenceType lastSequence_ {0};
+  uint64_t enqueued_ {0};
+  uint64_t syncRequestedAt_ {0};
+  uint64_t stalls_ {0};
+  // used by the background thread
+  std::mutex mtx_ {};
+  std::condition_variable_any cv_ {};
+  bool flushRequested_ {false};
+  bool syncRequested_ {false};
+  std::chrono::steady_clock::time_point unsyncedSince_ {};
+  alignas(detail::cacheLineSize) std::atomic<uint64_t> persisted_ {0};
+  std::atomic<uint64_t> durable_ {0};
+  std::atomic<uint64_t> syncs_ {0};
+  std::atomic<bool> failed_ {false};
+  std::exception_ptr error_ {};
+  // declared last: the thread must stop before the members it uses are gone
+  std::jthread flusher_ {};
+
+  void enqueue(const T& value, const memvarBase::sequenceType sequence) {
+    // a bulk append calls back once, with the newest value: the older
+    // values still in the history are logged before it
+    const auto missed {std::min<uint64_t>(sequence - lastSequence_ - 1,
+                                          static_cast<uint64_t>(mvt_.getHistorySize() - 1))};
+    for (auto k {missed}; k > 0; --k) {
+      push(entry {sequence - k,
+                  mvt_.getTimePoint(static_cast<size_t>(k)).time_since_epoch().count(),
+                  mvt_(static_cast<memvarBase::capacityType>(k))});
+    }
+    push(entry {sequence, mvt_.getTimePoint().time_since_epoch().count(), value});
+    lastSequence_ = sequence;
+    // the background thread is woken up once per group, not per value
+    if ( (0 != syncPolicy_.records_) && (enqueued_ - syncRequestedAt_ >= syncPolicy_.records_) ) {
+      requestSync();
+    }
+  }
+
+  void requestSync() {
+    syncRequestedAt_ = enqueued_;
+    {
+      std::lock_guard<std::mutex> lock {mtx_};
+      syncRequested_ = true;
+    }
+    cv_.notify_one();
+  }
+
+  void push(const entry& e) {
+    while ( !ring_.push(e) ) {
+      if ( failed_.load(std::memory_order_relaxed) ) {
+        // nothing drains the ring any more
+        return;
+      }
+      ++stalls_;
+      std::this_thread::yield();
+    }
+    ++enqueued_;
+  }
+
+  bool isSyncEnabled() const noexcept {
+    return (0 != syncPolicy_.records_) || (0 != syncPolicy_.interval_.count());
+  }
+
+  void run(std::stop_token stoken) {
+    while ( !stoken.stop_requested() && !failed_.load(std::memory_order_relaxed) ) {
+      bool syncRequested {false};
+      {
+        std::unique_lock<std::mutex> lock {mtx_};
+        cv_.wait_for(lock, stoken, nextWait(), [this] () { return flushRequested_ || syncRequested_; });
+        flushRequested_ = false;
+        syncRequested = std::exchange(syncRequested_, false);
+      }
+      writeBatch();
+      syncBatches(syncRequested);
+    }
+    writeBatch();
+    syncBatches(isSyncEnabled());
+  }
+
+  // the flush interval, shortened to the time left before the values not
+  // durable yet are due to be synced
+  std::chrono::microseconds nextWait() const {
+    if ( (0 == syncPolicy_.interval_.count()) ||
+         (durable_.load(std::memory_order_relaxed) == persisted_.load(std::memory_order_relaxed)) ) {
+      return flushInterval_;
+    }
+    const auto left {std::chrono::duration_cast<std::chrono::microseconds>(
+      unsyncedSince_ + syncPolicy_.interval_ - std::chrono::steady_clock::now())};
+    return std::clamp(left, std::chrono::microseconds {0}, flushInterval_);
+  }
+
+  void writeBatch() {
+    if ( failed_.load(std::memory_order_relaxed) ) {
+      return;
+    }
+    try {
+      const auto count {ring_.drain([this] (entry&& e) { log_.append(e); })};
+      if ( count > 0 ) {
+        log_.flush();
+        if ( durable_.load(std::memory_order_relaxed) == persisted_.load(std::memory_order_relaxed) ) {
+          unsyncedSince_ = std::chrono::steady_clock::now();
+        }
+        persisted_.fetch_add(count, std::memory_order_release);
+        persisted_.notify_all();
+      }
+    }
+    catch (...) {
+      fail();
+    }
+  }
+
+  // one fdatasync() for all the values written to the log since the last one
+  void syncBatches(const bool force) {
+    const auto persisted {persisted_.load(std::memory_order_relaxed)};
+    const auto waiting {persisted - durable_.load(std::memory_order_relaxed)};
+    if ( (0 == waiting) || failed_.load(std::memory_order_relaxed) ) {
+      return;
+    }
+    const bool due {force ||
+                    ((0 != syncPolicy_.records_) && (waiting >= syncPolicy_.records_)) ||
+                    ((0 != syncPolicy_.interval_.count()) &&
+                     (std::chrono::steady_clock::now() - unsyncedSince_ >= syncPolicy_.interval_))};
+    if ( !due ) {
+      return;
+    }
+    try {
+      log_.sync();
+      syncs_.fetch_add(1, std::memory_order_relaxed);
+      durable_.store(persisted, std::memory_order_release);
+      durable_.notify_all();
+    }
+    catch (...) {
+      fail();
+    }
+  }
+
+  void fail() {
+    error_ = std::current_exception();
+    failed_.store(true, std::memory_order_release);
+    persisted_.notify_all();
+    durable_.notify_all();
+  }
+};  // class memvarPersister
+
+// rebuild the history of mvt from the log at path, e.g. at startup before
+// attaching a memvarPersister: each value is stored with its time point
+// after a crash the log ends at the last whole record: with a logSyncPolicy
+// at least the values synced before the crash are replayed
+// returns the number of values replayed, 0 if there is no log
+template <typename T, typename Time, typename Clock>
+uint64_t replayLog(const std::string& path, memvarTimed<T, Time, Clock>& mvt) {
+  using timePoint = typename memvarTimed<T, Time, Clock>::timePoint;
+  return detail::scanLog<T, Time>(path, [&mvt] (const detail::logEntry<T, Time>& entry) {
+    mvt.setValueAt(entry.value_, timePoint(Time(entry.timePoint_)));
+  }).records_;
+}
+}  // namespace memvar
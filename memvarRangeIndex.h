@@ -0,0 +1,182 @@
+//
+// memvarRangeIndex.h
+//
+#pragma once
+
+#include "memvar.h"
+#include <bit>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// memvarRangeIndex
+// the min and max of any range of the history of a memvar in O(log n), n the
+// history capacity, instead of a scan of the range
+// a segment tree over a ring of the values by their sequence number: a
+// write replaces the leaf of the value written n writes before and updates
+// its O(log n) ancestors, so the history index of a value is the distance
+// of its sequence number from the one of the current value
+// the values written before the index is attached are read from the history;
+// a history capacity grown past the tree rebuilds it from the history
+// the history must keep every write: the memvar must not sample its writes
+// when attached; if a sampling policy is set later, the index goes stale at
+// the next write and the queries throw until the policy is back to
+// sampling::all, when the next write rebuilds the index from the history
+template <typename T>
+class memvarRangeIndex {
+ public:
+  using memvarType = memvar<T>;
+
+  explicit memvarRangeIndex(memvarType& mv) :
+  mv_ (mv) {
+    if ( sampling::all != mv.getSampling() ) {
+      throw std::invalid_argument("ERROR: A range index requires a memvar keeping every write");
+    }
+    rebuild();
+    id_ = mv.onChange([this] (const T& value, const memvarBase::sequenceType sequence) {
+      indexValues(value, sequence);
+    });
+  }
+
+  memvarRangeIndex(const memvarRangeIndex& rhs) = delete;
+  memvarRangeIndex& operator=(const memvarRangeIndex& rhs) = delete;
+
+  ~memvarRangeIndex() {
+    mv_.unsubscribe(id_);
+  }
+
+  // the min and max of the values at the history indices [first, last]
+  std::tuple<T, T> getRangeMinMax(const memvarBase::capacityType first, const memvarBase::capacityType last) const {
+    if ( stale_ ) {
+      throw std::logic_error("ERROR: The range index is stale: the memvar samples its writes");
+    }
+    if ( (first < 0) || (first > last) || (last >= mv_.getHistorySize()) ) {
+      throw std::out_of_range("ERROR: The history range [" + std::to_string(first) + ", " +
+                              std::to_string(last) + "] is not in the history");
+    }
+    const auto mask {size_ - 1};
+    // the oldest value is the one with the lowest sequence number
+    const auto low {static_cast<size_t>(sequence_ - static_cast<memvarBase::sequenceType>(last)) & mask};
+    const auto high {static_cast<size_t>(sequence_ - static_cast<memvarBase::sequenceType>(first)) & mask};
+    if ( low <= high ) {
+      return query(low, high);
+    }
+    // the range wraps around the ring
+    auto [min1, max1] {query(low, mask)};
+    const auto [min2, max2] {query(0, high)};
+    return std::make_tuple(std::min(min1, min2), std::max(max1, max2));
+  }
+
+  // the min and max of the newest count values, as many as in the history
+  std::tuple<T, T> getLastMinMax(const memvarBase::capacityType count) const {
+    return getRangeMinMax(0, std::min(count, mv_.getHistorySize()) - 1);
+  }
+
+  // the number of leaves of the tree
+  size_t getSize() const noexcept {
+    return size_;
+  }
+
+  // the history was written with a sampling policy since the last write
+  // indexed
+  bool isStale() const noexcept {
+    return stale_;
+  }
+
+ private:
+  memvarType& mv_;
+  typename memvarType::subscriptionId id_ {0};
+  // min and max side by side, so that a write touches a cache line per level
+  struct node {
+    T min_;
+    T max_;
+  };
+
+  // the node i has children 2i and 2i + 1, the leaves are [size_, 2 size_)
+  size_t size_ {0};
+  std::vector<node> tree_ {};
+  memvarBase::sequenceType sequence_ {0};
+  bool stale_ {false};
+
+  // index the history as it is
+  void rebuild() {
+    size_ = std::bit_ceil(static_cast<size_t>(mv_.getHistoryCapacity()));
+    tree_.assign(2 * size_, node {});
+    sequence_ = mv_.getSequence();
+    const auto& history {mv_.getMemVarHistory()};
+    const auto mask {size_ - 1};
+    for (size_t k {0}; k < history.size(); ++k) {
+      tree_[size_ + (static_cast<size_t>(sequence_ - k) & mask)] = {history[k], history[k]};
+    }
+    for (auto i {size_ - 1}; i > 0; --i) {
+      merge(i);
+    }
+    stale_ = false;
+  }
+
+  void indexValues(const T& value, const memvarBase::sequenceType sequence) {
+    // a sampled write may not be in the history, or may overwrite the
+    // current value: the values are no longer where their sequence numbers
+    // say
+    if ( sampling::all != mv_.getSampling() ) {
+      stale_ = true;
+      return;
+    }
+    if ( stale_ || (static_cast<size_t>(mv_.getHistoryCapacity()) > size_) ) {
+      rebuild();
+      return;
+    }
+    // a bulk append calls back once, with the newest value: the older
+    // values still in the history are indexed before it
+    const auto missed {std::min<uint64_t>(sequence - sequence_ - 1,
+                                          static_cast<uint64_t>(mv_.getHistorySize() - 1))};
+    for (auto k {missed}; k > 0; --k) {
+      update(sequence - k, mv_(static_cast<memvarBase::capacityType>(k)));
+    }
+    update(sequence, value);
+    sequence_ = sequence;
+  }
+
+  void update(const memvarBase::sequenceType sequence, const T& value) {
+    auto i {size_ + (static_cast<size_t>(sequence) & (size_ - 1))};
+    tree_[i] = {value, value};
+    // the ancestors of a node left as it was are left as they were too: a
+    // write rarely changes the min or max of a wide range
+    for (i /= 2; (i > 0) && merge(i); i /= 2) {
+    }
+  }
+
+  // returns if the node changed
+  bool merge(const size_t i) {
+    const auto& min {std::min(tree_[2 * i].min_, tree_[2 * i + 1].min_)};
+    const auto& max {std::max(tree_[2 * i].max_, tree_[2 * i + 1].max_)};
+    if ( (min == tree_[i].min_) && (max == tree_[i].max_) ) {
+      return false;
+    }
+    tree_[i] = {min, max};
+    return true;
+  }
+
+  // the min and max of the leaves [low, high]
+  std::tuple<T, T> query(size_t low, size_t high) const {
+    low += size_;
+    high += size_ + 1;
+    T min {tree_[low].min_};
+    T max {tree_[low].max_};
+    while ( low < high ) {
+      if ( low & 1 ) {
+        min = std::min(min, tree_[low].min_);
+        max = std::max(max, tree_[low].max_);
+        ++low;
+      }
+      if ( high & 1 ) {
+        --high;
+        min = std::min(min, tree_[high].min_);
+        max = std::max(max, tree_[high].max_);
+      }
+      low /= 2;
+      high /= 2;
+    }
+    return std::make_tuple(min, max);
+  }
+};  // class memvarRangeIndex
+}  // namespace memvar
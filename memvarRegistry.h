@@ -0,0 +1,219 @@
+//
+// memvarRegistry.h
+//
+#pragma once
+
+#include "memvarConcurrent.h"
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <limits>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// memvarRegistry
+// memvars of type Memvar created and looked up by key from any thread
+// the keys are spread over shards by their hash; each shard is an open
+// addressing hash table of pointers to the entries, so:
+// - a lookup takes no lock: it probes the table published by the shard
+// - a creation locks only its shard; the entry is fully built before its
+//   pointer is stored in the table, and a table that gets too full is
+//   replaced by a larger copy of it, the old one kept until the registry
+//   goes away as lookups may still be probing it
+// the memvars are never removed, so a reference to one is valid as long as
+// the registry
+// the memvars themselves are not synchronized by the registry: use a
+// Memvar type fit for the threads reading and writing it, e.g.
+// memvarConcurrent
+template <typename Memvar,
+          typename Key = std::string,
+          typename Hash = std::hash<Key>>
+class memvarRegistry {
+ public:
+  static constexpr size_t shardCountDefault_ {64};
+
+ private:
+  struct entry {
+    template <typename... Args>
+    entry(const Key& key, const size_t hash, Args&&... args) :
+    key_ (key),
+    hash_ (hash),
+    memvar_ (std::forward<Args>(args)...)
+    {}
+
+    const Key key_;
+    const size_t hash_;
+    Memvar memvar_;
+  };
+
+  struct table {
+    explicit table(const size_t size) :
+    mask_ (size - 1),
+    slots_ (std::make_unique<std::atomic<entry*>[]>(size))
+    {}
+
+    const size_t mask_;
+    std::unique_ptr<std::atomic<entry*>[]> slots_;
+  };
+
+  struct alignas(detail::cacheLineSize) shard {
+    // written by the creations under mtx_, read by the lookups
+    std::atomic<table*> table_ {nullptr};
+    std::mutex mtx_ {};
+    std::vector<std::unique_ptr<table>> tables_ {};
+    std::vector<std::unique_ptr<entry>> entries_ {};
+  };
+
+ public:
+  explicit memvarRegistry(const size_t shardCount = shardCountDefault_) :
+  shardCount_ (std::bit_ceil(std::max<size_t>(shardCount, 1))),
+  shardShift_ (std::numeric_limits<size_t>::digits - std::bit_width(shardCount_ - 1)),
+  shards_ (std::make_unique<shard[]>(shardCount_)) {
+    for (size_t i {0}; i < shardCount_; ++i) {
+      shards_[i].tables_.push_back(std::make_unique<table>(initialTableSize_));
+      shards_[i].table_.store(shards_[i].tables_.back().get(), std::memory_order_release);
+    }
+  }
+
+  memvarRegistry(const memvarRegistry& rhs) = delete;
+  memvarRegistry& operator=(const memvarRegistry& rhs) = delete;
+
+  // returns nullptr if no memvar has that key
+  Memvar* find(const Key& key) const {
+    const auto hash {Hash{}(key)};
+    entry* e {lookup(shardOf(hash), key, hash)};
+    return (nullptr == e) ? nullptr : &e->memvar_;
+  }
+
+  bool contains(const Key& key) const {
+    return nullptr != find(key);
+  }
+
+  // returns the memvar with that key, creating it from args if needed; the
+  // second value is true if it was created by this call
+  template <typename... Args>
+  std::pair<Memvar&, bool> tryEmplace(const Key& key, Args&&... args) {
+    const auto hash {Hash{}(key)};
+    shard& s {shardOf(hash)};
+    if ( entry* e {lookup(s, key, hash)}; nullptr != e ) {
+      return {e->memvar_, false};
+    }
+
+    std::scoped_lock lock {s.mtx_};
+    // another thread may have created it in the meantime
+    if ( entry* e {lookup(s, key, hash)}; nullptr != e ) {
+      return {e->memvar_, false};
+    }
+    auto* t {s.table_.load(std::memory_order_relaxed)};
+    // keep the table at most half full, so that the probe sequences stay short
+    if ( 2 * (s.entries_.size() + 1) > t->mask_ + 1 ) {
+      t = grow(s, *t);
+    }
+    s.entries_.push_back(std::make_unique<entry>(key, hash, std::forward<Args>(args)...));
+    insert(*t, s.entries_.back().get());
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return {s.entries_.back()->memvar_, true};
+  }
+
+  // returns the memvar with that key, creating it from args if needed
+  template <typename... Args>
+  Memvar& getOrCreate(const Key& key, Args&&... args) {
+    return tryEmplace(key, std::forward<Args>(args)...).first;
+  }
+
+  size_t size() const noexcept {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  size_t getShardCount() const noexcept {
+    return shardCount_;
+  }
+
+  // call f(key, memvar) with each memvar; the memvars created meanwhile may
+  // or may not be visited
+  template <typename F>
+  void forEach(F&& f) const {
+    for (size_t i {0}; i < shardCount_; ++i) {
+      forEachInShard(shards_[i], f);
+    }
+  }
+
+  // as forEach, with the shards split among threadCount threads: f is called
+  // concurrently from those threads
+  template <typename F>
+  void parallelForEach(F&& f, size_t threadCount = std::thread::hardware_concurrency()) const {
+    threadCount = std::clamp<size_t>(threadCount, 1, shardCount_);
+    std::vector<std::jthread> threads {};
+    threads.reserve(threadCount - 1);
+    auto visit = [this, &f, threadCount] (const size_t first) {
+      for (auto i {first}; i < shardCount_; i += threadCount) {
+        forEachInShard(shards_[i], f);
+      }
+    };
+    for (size_t t {1}; t < threadCount; ++t) {
+      threads.emplace_back(visit, t);
+    }
+    visit(0);
+  }
+
+ private:
+  static constexpr size_t initialTableSize_ {16};
+
+  const size_t shardCount_;
+  const int shardShift_;
+  std::unique_ptr<shard[]> shards_;
+  alignas(detail::cacheLineSize) std::atomic<size_t> size_ {0};
+
+  // the low bits of the hash pick the slot, and the high bits of the hash
+  // scrambled pick the shard, so that an identity hash of integer keys
+  // spreads them over the shards too
+  shard& shardOf(const size_t hash) const noexcept {
+    if ( 1 == shardCount_ ) {
+      return shards_[0];
+    }
+    return shards_[(hash * size_t {0x9e3779b97f4a7c15}) >> shardShift_];
+  }
+
+  static entry* lookup(const shard& s, const Key& key, const size_t hash) {
+    const table* t {s.table_.load(std::memory_order_acquire)};
+    for (size_t i {hash & t->mask_}; ; i = (i + 1) & t->mask_) {
+      entry* e {t->slots_[i].load(std::memory_order_acquire)};
+      if ( nullptr == e ) {
+        return nullptr;
+      }
+      if ( (e->hash_ == hash) && (e->key_ == key) ) {
+        return e;
+      }
+    }
+  }
+
+  static void insert(table& t, entry* e) noexcept {
+    auto i {e->hash_ & t.mask_};
+    while ( nullptr != t.slots_[i].load(std::memory_order_relaxed) ) {
+      i = (i + 1) & t.mask_;
+    }
+    t.slots_[i].store(e, std::memory_order_release);
+  }
+
+  // called with the shard locked
+  static table* grow(shard& s, const table& t) {
+    auto larger {std::make_unique<table>(2 * (t.mask_ + 1))};
+    for (const auto& e : s.entries_) {
+      insert(*larger, e.get());
+    }
+    s.tables_.push_back(std::move(larger));
+    s.table_.store(s.tables_.back().get(), std::memory_order_release);
+    return s.tables_.back().get();
+  }
+
+  template <typename F>
+  static void forEachInShard(const shard& s, F& f) {
+    const table* t {s.table_.load(std::memory_order_acquire)};
+    for (size_t i {0}; i <= t->mask_; ++i) {
+      if ( entry* e {t->slots_[i].load(std::memory_order_acquire)}; nullptr != e ) {
+        f(e->key_, e->memvar_);
+      }
+    }
+  }
+};  // class memvarRegistry
+}  // namespace memvar
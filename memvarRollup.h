@@ -0,0 +1,205 @@
+//
+// memvarRollup.h
+//
+#pragma once
+
+#include "memvar.h"
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// A rollup tier: buckets of resolution_ covering the last retention_
+struct rollupTier {
+  std::chrono::nanoseconds resolution_;
+  std::chrono::nanoseconds retention_;
+};
+
+// 1 second buckets for the last hour, 1 minute buckets for the last day
+inline std::vector<rollupTier> rollupTiersDefault() {
+  using namespace std::chrono_literals;
+  return {{1s, 1h}, {1min, 24h}};
+}
+
+// memvarRollup
+// RRD style rollups of the values written to a memvarTimed: each tier keeps
+// min, max, sum, count and last value of the values written in each bucket
+// of its resolution, the buckets aligned on the epoch of the clock
+// a write updates the newest bucket of each tier, or starts a new one and
+// drops the buckets older than the retention of the tier, so the memory of
+// a tier is bounded by retention / resolution buckets
+// query() picks the finest resolution reaching back to the start of the
+// time range: the history of the memvarTimed itself, then the tiers from
+// the finest to the coarsest one
+// the values written after the rollup is attached are rolled up, the ones of
+// a bulk append included, as far as they are in the history
+// only integral or floating point types allowed
+template <typename T,
+          typename Time = std::chrono::nanoseconds,
+          typename Clock = std::chrono::high_resolution_clock>
+class memvarRollup {
+  static_assert(std::is_arithmetic_v<T>, "Integral or floating point type required.");
+
+ public:
+  using memvarType = memvarTimed<T, Time, Clock>;
+  using timePoint = typename memvarType::timePoint;
+  using sumType = std::conditional_t<std::is_floating_point_v<T>, double,
+                  std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+  struct bucket {
+    timePoint start_ {};
+    T min_ {};
+    T max_ {};
+    sumType sum_ {};
+    uint64_t count_ {0};
+    T last_ {};
+  };
+
+  // the buckets of a query, oldest first: a bucket for each value when
+  // resolution_ is 0, i.e. read from the history of the memvarTimed
+  struct rollupResult {
+    Time resolution_ {0};
+    std::vector<bucket> buckets_ {};
+  };
+
+  explicit memvarRollup(memvarType& mvt, std::vector<rollupTier> tiers = rollupTiersDefault()) :
+  mvt_ (mvt) {
+    std::sort(tiers.begin(), tiers.end(), [] (const rollupTier& lhs, const rollupTier& rhs) {
+      return lhs.resolution_ < rhs.resolution_;
+    });
+    for (const auto& t : tiers) {
+      const auto resolution {std::chrono::duration_cast<Time>(t.resolution_)};
+      if ( resolution <= Time::zero() ) {
+        throw std::invalid_argument("ERROR: The resolution of a rollup tier must be greater than 0");
+      }
+      tiers_.push_back({resolution, std::chrono::duration_cast<Time>(t.retention_), {}});
+    }
+    lastSequence_ = mvt.getSequence();
+    id_ = mvt.onChange([this] (const T& value, const memvarBase::sequenceType sequence) {
+      rollUp(value, sequence);
+    });
+  }
+
+  memvarRollup(const memvarRollup& rhs) = delete;
+  memvarRollup& operator=(const memvarRollup& rhs) = delete;
+
+  ~memvarRollup() {
+    mvt_.unsubscribe(id_);
+  }
+
+  size_t getTierCount() const noexcept {
+    return tiers_.size();
+  }
+
+  Time getResolution(const size_t tier) const {
+    return tiers_.at(tier).resolution_;
+  }
+
+  // the buckets of a tier, from newest to oldest
+  const std::deque<bucket>& getBuckets(const size_t tier) const {
+    return tiers_.at(tier).buckets_;
+  }
+
+  // the values written in [from, to], at the finest resolution available
+  // back to from
+  rollupResult query(const timePoint& from, const timePoint& to) const {
+    rollupResult result {};
+    const auto size {static_cast<size_t>(mvt_.getHistorySize())};
+    if ( mvt_.getTimePoint(size - 1) <= from ) {
+      for (auto i {size}; i > 0; --i) {
+        const auto when {mvt_.getTimePoint(i - 1)};
+        if ( (when >= from) && (when <= to) ) {
+          const T value {mvt_(static_cast<memvarBase::capacityType>(i - 1))};
+          result.buckets_.push_back({when, value, value, static_cast<sumType>(value), 1, value});
+        }
+      }
+      return result;
+    }
+    if ( tiers_.empty() ) {
+      return result;
+    }
+    // the coarsest tier if none reaches back to from
+    const auto newest {mvt_.getTimePoint()};
+    auto t {std::find_if(tiers_.cbegin(), tiers_.cend(), [&from, &newest] (const tier& candidate) {
+      return from >= newest - candidate.retention_;
+    })};
+    if ( t == tiers_.cend() ) {
+      --t;
+    }
+    result.resolution_ = t->resolution_;
+    for (auto it {t->buckets_.crbegin()}; it != t->buckets_.crend(); ++it) {
+      if ( (it->start_ + t->resolution_ > from) && (it->start_ <= to) ) {
+        result.buckets_.push_back(*it);
+      }
+    }
+    return result;
+  }
+
+ private:
+  struct tier {
+    Time resolution_;
+    Time retention_;
+    // newest bucket first
+    std::deque<bucket> buckets_;
+  };
+
+  memvarType& mvt_;
+  std::vector<tier> tiers_ {};
+  typename memvar<T>::subscriptionId id_ {0};
+  memvarBase::sequenceType lastSequence_ {0};
+
+  void rollUp(const T& value, const memvarBase::sequenceType sequence) {
+    // a bulk append calls back once, with the newest value: the older
+    // values still in the history are rolled up before it
+    const auto missed {std::min<uint64_t>(sequence - lastSequence_ - 1,
+                                          static_cast<uint64_t>(mvt_.getHistorySize() - 1))};
+    for (auto k {missed}; k > 0; --k) {
+      add(mvt_(static_cast<memvarBase::capacityType>(k)), mvt_.getTimePoint(static_cast<size_t>(k)));
+    }
+    add(value, mvt_.getTimePoint());
+    lastSequence_ = sequence;
+  }
+
+  static void update(bucket& b, const T& value) noexcept {
+    b.min_ = std::min(b.min_, value);
+    b.max_ = std::max(b.max_, value);
+    b.sum_ += static_cast<sumType>(value);
+    ++b.count_;
+    b.last_ = value;
+  }
+
+  void add(const T& value, const timePoint& when) {
+    for (auto& t : tiers_) {
+      auto& buckets {t.buckets_};
+      // most writes fall in the newest bucket
+      if ( !buckets.empty() && (when >= buckets.front().start_) && (when < buckets.front().start_ + t.resolution_) ) {
+        update(buckets.front(), value);
+        continue;
+      }
+      const auto since {when.time_since_epoch()};
+      auto offset {since % t.resolution_};
+      if ( offset < Time::zero() ) {
+        offset += t.resolution_;
+      }
+      const timePoint start {since - offset};
+      // the values come in time order but for setValueAt() with an older
+      // time point: look for the bucket back from the newest one
+      auto it {buckets.begin()};
+      while ( (it != buckets.end()) && (it->start_ > start) ) {
+        ++it;
+      }
+      if ( (it == buckets.end()) || (it->start_ < start) ) {
+        if ( (it == buckets.end()) && !buckets.empty() && (start < buckets.front().start_ - t.retention_) ) {
+          // older than the retention of the tier
+          continue;
+        }
+        it = buckets.insert(it, bucket {start, value, value, static_cast<sumType>(value), 1, value});
+      }
+      else {
+        update(*it, value);
+      }
+      while ( (buckets.size() > 1) && (buckets.back().start_ + t.resolution_ <= buckets.front().start_ - t.retention_) ) {
+        buckets.pop_back();
+      }
+    }
+  }
+};  // class memvarRollup
+}  // namespace memvar
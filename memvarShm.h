@@ -0,0 +1,460 @@
+//
+// memvarShm.h
+//
+#pragma once
+
+#include "memvarConcurrent.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <new>
+#include <system_error>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// How a memvarShared gets its shared memory object
+enum class sharedOpenMode {
+  create,  // fail if an object with the same name exists
+  replace  // remove an object with the same name first, e.g. one left by a
+           // writer that crashed; readers still attached to it keep it
+};
+
+namespace detail
+{
+// the layout of a shared memory segment holding a memvar:
+// a header, followed by the ring of the (value, time tag) slots
+struct sharedHeader {
+  static constexpr uint64_t magic {0x6d656d7661720001};
+  static constexpr uint32_t version {3};
+
+  // stored last by the writer, once the rest of the header is set up
+  std::atomic<uint64_t> magic_ {0};
+  uint32_t version_ {0};
+  uint32_t valueSize_ {0};
+  uint32_t timeSize_ {0};
+  uint32_t slotSize_ {0};
+  // the time tag unit: Time::period
+  int64_t periodNum_ {0};
+  int64_t periodDen_ {0};
+  // the time the writer was created, in Time units from the epoch of its
+  // clock: the time tags count from it
+  int64_t epoch_ {0};
+  uint64_t ringSize_ {0};
+  // written by the writer, read by the readers
+  alignas(cacheLineSize) std::atomic<uint64_t> head_ {0};
+  // the history capacity, lower than the ring size, and the sequence number
+  // before which the writer dropped the values when it lowered the capacity
+  std::atomic<int64_t> historyCapacity_ {0};
+  std::atomic<uint64_t> first_ {0};
+};
+
+template <typename T, typename Time>
+struct sharedValue {
+  T value_;
+  typename Time::rep timeTag_;
+};
+
+template <typename T, typename Time>
+using sharedSlot = seqlockSlot<sharedValue<T, Time>>;
+
+template <typename T, typename Time>
+constexpr size_t sharedSlotsOffset() noexcept {
+  constexpr auto alignment {alignof(sharedSlot<T, Time>)};
+  return ((sizeof(sharedHeader) + alignment - 1) / alignment) * alignment;
+}
+
+[[noreturn]] inline void throwSystemError(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// sharedMapping
+// a shared memory object mapped in the address space of the process
+class sharedMapping {
+ public:
+  sharedMapping() = default;
+
+  sharedMapping(const sharedMapping& rhs) = delete;
+  sharedMapping& operator=(const sharedMapping& rhs) = delete;
+
+  ~sharedMapping() {
+    if ( nullptr != address_ ) {
+      ::munmap(address_, size_);
+    }
+    if ( unlink_ ) {
+      ::shm_unlink(name_.c_str());
+    }
+  }
+
+  // create the object: it must not exist already, so that there is only one
+  // writer, unless it is replaced; it is removed when the mapping is destroyed
+  void create(const std::string& name, const size_t size, const sharedOpenMode mode) {
+    if ( (sharedOpenMode::replace == mode) && (-1 == ::shm_unlink(name.c_str())) && (ENOENT != errno) ) {
+      throwSystemError("shm_unlink " + name);
+    }
+    const int fd {::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644)};
+    if ( -1 == fd ) {
+      throwSystemError("shm_open " + name);
+    }
+    name_ = name;
+    unlink_ = true;
+    if ( -1 == ::ftruncate(fd, static_cast<off_t>(size)) ) {
+      const auto error {errno};
+      ::close(fd);
+      errno = error;
+      throwSystemError("ftruncate " + name);
+    }
+    map(fd, size, PROT_READ | PROT_WRITE);
+  }
+
+  // attach to an existing object read-only
+  void attach(const std::string& name) {
+    const int fd {::shm_open(name.c_str(), O_RDONLY, 0)};
+    if ( -1 == fd ) {
+      throwSystemError("shm_open " + name);
+    }
+    name_ = name;
+    struct stat status {};
+    if ( -1 == ::fstat(fd, &status) ) {
+      const auto error {errno};
+      ::close(fd);
+      errno = error;
+      throwSystemError("fstat " + name);
+    }
+    map(fd, static_cast<size_t>(status.st_size), PROT_READ);
+  }
+
+  void* address() const noexcept {
+    return address_;
+  }
+
+  size_t size() const noexcept {
+    return size_;
+  }
+
+ private:
+  std::string name_ {};
+  void* address_ {nullptr};
+  size_t size_ {0};
+  bool unlink_ {false};
+
+  void map(const int fd, const size_t size, const int protection) {
+    void* address {::mmap(nullptr, size, protection, MAP_SHARED, fd, 0)};
+    const auto error {errno};
+    ::close(fd);
+    if ( MAP_FAILED == address ) {
+      errno = error;
+      throwSystemError("mmap " + name_);
+    }
+    address_ = address;
+    size_ = size;
+  }
+};  // class sharedMapping
+
+// sharedHistory
+// the reads on the ring of a memvar in shared memory, for the writer and
+// the readers alike
+template <typename T, typename Time>
+class sharedHistory {
+ public:
+  using historyTimedValue = std::tuple<T, Time, bool>;
+
+  sharedHistory() = default;
+
+  sharedHistory(const sharedHeader* header, const sharedSlot<T, Time>* slots) noexcept :
+  header_ (header),
+  slots_ (slots),
+  ringMask_ (header->ringSize_ - 1)
+  {}
+
+  auto getHistoryValue(const memvarBase::capacityType index) const noexcept -> historyTimedValue {
+    sharedValue<T, Time> value {};
+    while ( true ) {
+      const auto head {header_->head_.load(std::memory_order_acquire)};
+      if ( (index < 0) || (index >= historySize(head)) ) {
+        return std::make_tuple(T{}, Time{0}, true);
+      }
+      const auto n {head - 1 - static_cast<uint64_t>(index)};
+      if ( readSlot(slots_[n & ringMask_], n, value) ) {
+        return std::make_tuple(value.value_, Time{value.timeTag_}, false);
+      }
+    }
+  }
+
+  // call f(value, timeTag) with each value in the history, from the oldest
+  // value to the newest one; the values overwritten by the writer while
+  // they are visited are skipped
+  template <typename F>
+  void forEach(F&& f) const {
+    const auto head {header_->head_.load(std::memory_order_acquire)};
+    sharedValue<T, Time> value {};
+    for (auto n {head - static_cast<uint64_t>(historySize(head))}; n < head; ++n) {
+      if ( readSlot(slots_[n & ringMask_], n, value) ) {
+        f(value.value_, Time{value.timeTag_});
+      }
+    }
+  }
+
+  memvarBase::capacityType historySize(const uint64_t head) const noexcept {
+    const auto capacity {static_cast<uint64_t>(header_->historyCapacity_.load(std::memory_order_acquire))};
+    const auto first {header_->first_.load(std::memory_order_acquire)};
+    return static_cast<memvarBase::capacityType>(std::min({head, capacity, (head > first) ? head - first : 0}));
+  }
+
+  uint64_t getWriteCount() const noexcept {
+    return header_->head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  const sharedHeader* header_ {nullptr};
+  const sharedSlot<T, Time>* slots_ {nullptr};
+  uint64_t ringMask_ {0};
+};  // class sharedHistory
+}  // namespace detail
+
+// memvarShared
+// a time tagged memvar whose history lives in a POSIX shared memory object,
+// written by one thread of one process
+// other processes read it with a memvarSharedReader, without copying the
+// history out of the object and without system calls: the values are
+// published in a ring of seqlock slots as in a memvarConcurrent
+// the object is created by the constructor, that fails if an object with
+// the same name exists unless the mode is sharedOpenMode::replace, and it is
+// removed by the destructor; the readers attached can still read it until
+// they are destroyed
+// only trivially copyable types allowed
+template <typename T,
+          typename Time = std::chrono::nanoseconds,
+          typename Clock = std::chrono::system_clock>
+class memvarShared : public memvarBase {
+ public:
+  using historyTimedValue = std::tuple<T, Time, bool>;
+
+  explicit memvarShared(const std::string& name,
+                        const T& value = T{},
+                        const capacityType historyCapacity = historyCapacityDefault_,
+                        const sharedOpenMode mode = sharedOpenMode::create) :
+  memvarBase(historyCapacity) {
+    static_assert(std::is_trivially_copyable_v<T>, "Trivially copyable type required.");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Lock-free 64-bit atomics required.");
+    checkHistoryCapacity(historyCapacity_);
+    const auto ringSize {std::bit_ceil(static_cast<uint64_t>(historyCapacity_) + 1)};
+    mapping_.create(name,
+                    detail::sharedSlotsOffset<T, Time>() + ringSize * sizeof(detail::sharedSlot<T, Time>),
+                    mode);
+
+    auto* address {static_cast<std::byte*>(mapping_.address())};
+    header_ = new (address) detail::sharedHeader {};
+    slots_ = reinterpret_cast<detail::sharedSlot<T, Time>*>(address + detail::sharedSlotsOffset<T, Time>());
+    std::uninitialized_value_construct_n(slots_, ringSize);
+    header_->version_ = detail::sharedHeader::version;
+    header_->valueSize_ = sizeof(T);
+    header_->timeSize_ = sizeof(typename Time::rep);
+    header_->slotSize_ = sizeof(detail::sharedSlot<T, Time>);
+    header_->periodNum_ = static_cast<int64_t>(Time::period::num);
+    header_->periodDen_ = static_cast<int64_t>(Time::period::den);
+    header_->historyCapacity_.store(historyCapacity_, std::memory_order_relaxed);
+    header_->ringSize_ = ringSize;
+    history_ = detail::sharedHistory<T, Time>(header_, slots_);
+    memvarEpoch_ = Clock::now();
+    header_->epoch_ = std::chrono::duration_cast<Time>(memvarEpoch_.time_since_epoch()).count();
+    setValue(value);
+    header_->magic_.store(detail::sharedHeader::magic, std::memory_order_release);
+  }
+
+  memvarShared(const memvarShared& rhs) = delete;
+  memvarShared& operator=(const memvarShared& rhs) = delete;
+  memvarShared(memvarShared&& rhs) = delete;
+  memvarShared& operator=(memvarShared&& rhs) = delete;
+
+  ~memvarShared() override = default;
+
+  memvarShared& operator=(const T& rhs) noexcept {
+    setValue(rhs);
+    return *this;
+  }
+
+  operator T() const noexcept {
+    return (*this)();
+  }
+
+  T operator()() const noexcept {
+    return std::get<T>(history_.getHistoryValue(0));
+  }
+
+  T operator()(const capacityType index) const noexcept {
+    return std::get<T>(history_.getHistoryValue(index));
+  }
+
+  auto getHistoryValue(const capacityType index) const noexcept -> historyTimedValue {
+    return history_.getHistoryValue(index);
+  }
+
+  // the time tag is measured in Time units from the time the memvar was
+  // created
+  Time getTimeTag(const capacityType index = 0) const noexcept {
+    return std::get<Time>(history_.getHistoryValue(index));
+  }
+
+  // the time the memvar was created, in Time units from the epoch of Clock
+  Time getEpoch() const noexcept {
+    return Time(header_->epoch_);
+  }
+
+  capacityType getHistorySize() const noexcept {
+    return history_.historySize(history_.getWriteCount());
+  }
+
+  // the largest capacity the ring allocated by the constructor can hold
+  capacityType getMaxHistoryCapacity() const noexcept {
+    return static_cast<capacityType>(header_->ringSize_ - 1);
+  }
+
+  // shrinking drops the oldest values for good, for the readers as well;
+  // growing is bounded by the ring and keeps the values already in the history
+  void setHistoryCapacity(const capacityType historyCapacity) {
+    checkHistoryCapacity(historyCapacity);
+    if ( historyCapacity > getMaxHistoryCapacity() ) {
+      throw std::invalid_argument("ERROR: The history capacity of a memvarShared cannot grow past " +
+                                  std::to_string(getMaxHistoryCapacity()) + ".");
+    }
+    const auto head {header_->head_.load(std::memory_order_relaxed)};
+    if ( historyCapacity < history_.historySize(head) ) {
+      header_->first_.store(head - static_cast<uint64_t>(historyCapacity), std::memory_order_release);
+    }
+    header_->historyCapacity_.store(historyCapacity, std::memory_order_release);
+    historyCapacity_ = historyCapacity;
+  }
+
+  uint64_t getWriteCount() const noexcept {
+    return history_.getWriteCount();
+  }
+
+  sequenceType getSequence() const noexcept {
+    return history_.getWriteCount() - 1;
+  }
+
+ private:
+  detail::sharedMapping mapping_ {};
+  detail::sharedHeader* header_ {nullptr};
+  detail::sharedSlot<T, Time>* slots_ {nullptr};
+  detail::sharedHistory<T, Time> history_ {};
+  typename Clock::time_point memvarEpoch_ {};
+
+  void setValue(const T& value) noexcept {
+    const auto n {header_->head_.load(std::memory_order_relaxed)};
+    const detail::sharedValue<T, Time> timedValue {value,
+      std::chrono::duration_cast<Time>(Clock::now() - memvarEpoch_).count()};
+    detail::writeSlot(slots_[n & (header_->ringSize_ - 1)], n, timedValue);
+    header_->head_.store(n + 1, std::memory_order_release);
+  }
+};  // class memvarShared
+
+// memvarSharedReader
+// a read-only view of a memvarShared, possibly written by another process
+// the constructor attaches to the shared memory object and fails if it is
+// not a memvarShared of the same value and time tag types
+// any number of threads can read through the same reader
+template <typename T,
+          typename Time = std::chrono::nanoseconds>
+class memvarSharedReader {
+ public:
+  using historyTimedValue = std::tuple<T, Time, bool>;
+
+  explicit memvarSharedReader(const std::string& name) {
+    static_assert(std::is_trivially_copyable_v<T>, "Trivially copyable type required.");
+    mapping_.attach(name);
+    if ( mapping_.size() < sizeof(detail::sharedHeader) ) {
+      throw std::runtime_error("memvarSharedReader: " + name + " is not a memvar");
+    }
+    auto* address {static_cast<const std::byte*>(mapping_.address())};
+    header_ = std::launder(reinterpret_cast<const detail::sharedHeader*>(address));
+    if ( header_->magic_.load(std::memory_order_acquire) != detail::sharedHeader::magic ) {
+      throw std::runtime_error("memvarSharedReader: " + name + " is not a memvar, or it is not ready yet");
+    }
+    if ( (header_->version_ != detail::sharedHeader::version) ||
+         (header_->valueSize_ != sizeof(T)) ||
+         (header_->timeSize_ != sizeof(typename Time::rep)) ||
+         (header_->periodNum_ != static_cast<int64_t>(Time::period::num)) ||
+         (header_->periodDen_ != static_cast<int64_t>(Time::period::den)) ||
+         (header_->slotSize_ != sizeof(detail::sharedSlot<T, Time>)) ) {
+      throw std::invalid_argument("memvarSharedReader: " + name + " does not match the value or time tag types");
+    }
+    // the slots are indexed by a mask of the ring size, and the ring must
+    // hold the history and the slot being written; the writer can lower or
+    // raise the capacity afterwards, within the ring
+    const auto ringSize {header_->ringSize_};
+    const auto historyCapacity {header_->historyCapacity_.load(std::memory_order_acquire)};
+    if ( !std::has_single_bit(ringSize) ||
+         (historyCapacity <= 0) ||
+         (ringSize <= static_cast<uint64_t>(historyCapacity)) ) {
+      throw std::runtime_error("memvarSharedReader: " + name + " has a corrupted header");
+    }
+    if ( (mapping_.size() < detail::sharedSlotsOffset<T, Time>()) ||
+         (ringSize > (mapping_.size() - detail::sharedSlotsOffset<T, Time>()) / sizeof(detail::sharedSlot<T, Time>)) ) {
+      throw std::runtime_error("memvarSharedReader: " + name + " is truncated");
+    }
+    history_ = detail::sharedHistory<T, Time>(header_,
+      std::launder(reinterpret_cast<const detail::sharedSlot<T, Time>*>(address + detail::sharedSlotsOffset<T, Time>())));
+  }
+
+  memvarSharedReader(const memvarSharedReader& rhs) = delete;
+  memvarSharedReader& operator=(const memvarSharedReader& rhs) = delete;
+
+  operator T() const noexcept {
+    return (*this)();
+  }
+
+  T operator()() const noexcept {
+    return std::get<T>(history_.getHistoryValue(0));
+  }
+
+  T operator()(const memvarBase::capacityType index) const noexcept {
+    return std::get<T>(history_.getHistoryValue(index));
+  }
+
+  auto getHistoryValue(const memvarBase::capacityType index) const noexcept -> historyTimedValue {
+    return history_.getHistoryValue(index);
+  }
+
+  Time getTimeTag(const memvarBase::capacityType index = 0) const noexcept {
+    return std::get<Time>(history_.getHistoryValue(index));
+  }
+
+  // the time the writer was created, in Time units from the epoch of its
+  // clock: the time point of a value is getEpoch() + its time tag
+  Time getEpoch() const noexcept {
+    return Time(header_->epoch_);
+  }
+
+  // call f(value, timeTag) with each value in the history, oldest first
+  template <typename F>
+  void forEach(F&& f) const {
+    history_.forEach(std::forward<F>(f));
+  }
+
+  memvarBase::capacityType getHistoryCapacity() const noexcept {
+    return header_->historyCapacity_.load(std::memory_order_acquire);
+  }
+
+  memvarBase::capacityType getHistorySize() const noexcept {
+    return history_.historySize(history_.getWriteCount());
+  }
+
+  uint64_t getWriteCount() const noexcept {
+    return history_.getWriteCount();
+  }
+
+  // poll it to detect a change: the readers are in other processes, so the
+  // writer does not wake them up
+  memvarBase::sequenceType getSequence() const noexcept {
+    return history_.getWriteCount() - 1;
+  }
+
+ private:
+  detail::sharedMapping mapping_ {};
+  const detail::sharedHeader* header_ {nullptr};
+  detail::sharedHistory<T, Time> history_ {};
+};  // class memvarSharedReader
+}  // namespace memvar
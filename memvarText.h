@@ -0,0 +1,277 @@
+//
+// memvarText.h
+//
+#pragma once
+
+#include "memvarUtf8.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <locale>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// How the text of a value is escaped by a textWriter
+enum class textEscape {
+  none,
+  csv,  // quoted if it holds a comma, a quote or a line break
+  json  // a JSON string for the text values, null for a non finite number
+};
+
+// textWriter
+// formats values into a large buffer handed over to an ostream or a FILE
+// in big chunks; the numbers are formatted by std::to_chars, without locale
+// or stream state: the floating point numbers in the shortest form that
+// reads back the same value, or with a precision as in printf("%g")
+// with streamFormat the numbers are formatted as the ostream would: by
+// to_chars at its precision when its flags and locale are the default ones,
+// else by operator<< with its flags, e.g. std::hex, std::fixed, boolalpha
+// a failed write to a FILE throws std::system_error from flush(); the
+// destructor flushes too, but it cannot report the failure
+class textWriter {
+ public:
+  static constexpr size_t bufferSizeDefault_ {1 << 16};
+
+  struct streamFormat {};
+
+  explicit textWriter(std::ostream& os,
+                      const int precision = 0,
+                      const size_t bufferSize = bufferSizeDefault_) :
+  os_ (&os),
+  precision_ (precision),
+  buffer_ (std::max<size_t>(bufferSize, minimumBufferSize_))
+  {}
+
+  explicit textWriter(std::FILE* file,
+                      const int precision = 0,
+                      const size_t bufferSize = bufferSizeDefault_) :
+  file_ (file),
+  precision_ (precision),
+  buffer_ (std::max<size_t>(bufferSize, minimumBufferSize_))
+  {}
+
+  textWriter(std::ostream& os,
+             streamFormat,
+             const size_t bufferSize = bufferSizeDefault_) :
+  os_ (&os),
+  precision_ (static_cast<int>(os.precision())),
+  buffer_ (std::max<size_t>(bufferSize, minimumBufferSize_)),
+  byStream_ ((os.flags() != (std::ios_base::dec | std::ios_base::skipws)) ||
+             (os.getloc() != std::locale::classic()))
+  {
+    if ( byStream_ ) {
+      scratch_.copyfmt(os);
+      scratch_.width(0);
+    }
+  }
+
+  textWriter(const textWriter& rhs) = delete;
+  textWriter& operator=(const textWriter& rhs) = delete;
+
+  ~textWriter() {
+    try {
+      flush();
+    }
+    catch (const std::system_error&) {
+    }
+  }
+
+  void write(const std::string_view text) {
+    if ( text.size() > buffer_.size() - used_ ) {
+      flush();
+      if ( text.size() > buffer_.size() ) {
+        output(text.data(), text.size());
+        return;
+      }
+    }
+    std::memcpy(buffer_.data() + used_, text.data(), text.size());
+    used_ += text.size();
+  }
+
+  void put(const char c) {
+    if ( used_ == buffer_.size() ) {
+      flush();
+    }
+    buffer_[used_++] = c;
+  }
+
+  template <typename T>
+  void writeValue(const T& value, const textEscape escape = textEscape::none) {
+    if constexpr ( std::is_same_v<T, bool> ) {
+      if ( textEscape::json == escape ) {
+        write(value ? "true" : "false");
+      }
+      else if ( byStream_ ) {
+        writeByStream(value);
+      }
+      else {
+        put(value ? '1' : '0');
+      }
+    }
+    else if constexpr ( std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char> ) {
+      // as an ostream does
+      writeText(std::string_view(reinterpret_cast<const char*>(&value), 1), escape);
+    }
+    else if constexpr ( std::is_integral_v<T> ) {
+      writeNumber(value);
+    }
+    else if constexpr ( std::is_floating_point_v<T> ) {
+      if ( (textEscape::json == escape) && !std::isfinite(value) ) {
+        write("null");
+        return;
+      }
+      writeNumber(value);
+    }
+    else if constexpr ( std::is_same_v<T, std::string> ) {
+      writeText(value, escape);
+    }
+    else if constexpr ( std::is_same_v<T, std::u8string> ) {
+      writeText(std::string_view(reinterpret_cast<const char*>(value.data()), value.size()), escape);
+    }
+    else if constexpr ( std::is_same_v<T, std::wstring> || std::is_same_v<T, std::u16string> || std::is_same_v<T, std::u32string> ) {
+      writeWideText(std::basic_string_view<typename T::value_type>(value), escape);
+    }
+    else {
+      // any other type is formatted by its operator<<
+      scratch_.str(std::string {});
+      scratch_ << value;
+      writeText(scratch_.view(), escape);
+    }
+  }
+
+  // hand the buffered text over to the output
+  void flush() {
+    if ( used_ > 0 ) {
+      const auto used {std::exchange(used_, 0)};
+      output(buffer_.data(), used);
+    }
+  }
+
+ private:
+  // room for the longest number
+  static constexpr size_t minimumBufferSize_ {128};
+
+  std::ostream* os_ {nullptr};
+  std::FILE* file_ {nullptr};
+  const int precision_;
+  std::vector<char> buffer_;
+  size_t used_ {0};
+  // the numbers formatted by operator<< with the flags of the stream
+  const bool byStream_ {false};
+  std::ostringstream scratch_ {};
+  std::string utf8_ {};
+
+  void output(const char* data, const size_t size) {
+    if ( nullptr != os_ ) {
+      os_->write(data, static_cast<std::streamsize>(size));
+    }
+    else if ( std::fwrite(data, 1, size, file_) != size ) {
+      throw std::system_error(errno, std::generic_category(), "fwrite");
+    }
+  }
+
+  template <typename T>
+  void writeByStream(const T value) {
+    scratch_.str(std::string {});
+    scratch_ << value;
+    write(scratch_.view());
+  }
+
+  template <typename T>
+  void writeNumber(const T value) {
+    if ( byStream_ ) {
+      writeByStream(value);
+      return;
+    }
+    if ( buffer_.size() - used_ < minimumBufferSize_ ) {
+      flush();
+    }
+    char* first {buffer_.data() + used_};
+    char* last {buffer_.data() + buffer_.size()};
+    std::to_chars_result result {};
+    if constexpr ( std::is_floating_point_v<T> ) {
+      result = (precision_ > 0) ? std::to_chars(first, last, value, std::chars_format::general, precision_)
+                                : std::to_chars(first, last, value);
+    }
+    else {
+      result = std::to_chars(first, last, value);
+    }
+    used_ = static_cast<size_t>(result.ptr - buffer_.data());
+  }
+
+  // the wide strings are transcoded to UTF-8 straight into the buffer, and
+  // through utf8_ when they are escaped
+  template <typename CharT>
+  void writeWideText(std::basic_string_view<CharT> text, const textEscape escape) {
+    if ( textEscape::none != escape ) {
+      utf8_.clear();
+      writeText(appendUtf8(utf8_, text), escape);
+      return;
+    }
+    while ( !text.empty() ) {
+      if ( buffer_.size() - used_ < minimumBufferSize_ ) {
+        flush();
+      }
+      const auto units {utf8ChunkSize(text, buffer_.size() - used_)};
+      used_ = static_cast<size_t>(toUtf8(text.substr(0, units), buffer_.data() + used_) - buffer_.data());
+      text.remove_prefix(units);
+    }
+  }
+
+  void writeText(const std::string_view text, const textEscape escape) {
+    switch ( escape ) {
+      case textEscape::none:
+        write(text);
+        break;
+      case textEscape::csv:
+        if ( std::string_view::npos == text.find_first_of(",\"\r\n") ) {
+          write(text);
+          break;
+        }
+        put('"');
+        for (const char c : text) {
+          if ( '"' == c ) {
+            put('"');
+          }
+          put(c);
+        }
+        put('"');
+        break;
+      case textEscape::json:
+        put('"');
+        for (const char c : text) {
+          switch ( c ) {
+            case '"':  write("\\\""); break;
+            case '\\': write("\\\\"); break;
+            case '\n': write("\\n"); break;
+            case '\r': write("\\r"); break;
+            case '\t': write("\\t"); break;
+            default:
+              if ( static_cast<unsigned char>(c) < 0x20 ) {
+                static constexpr char hex[] {"0123456789abcdef"};
+                write("\\u00");
+                put(hex[(c >> 4) & 0xf]);
+                put(hex[c & 0xf]);
+              }
+              else {
+                put(c);
+              }
+          }
+        }
+        put('"');
+        break;
+    }
+  }
+};  // class textWriter
+}  // namespace memvar
@@ -0,0 +1,405 @@
+//
+// memvarTiered.h
+//
+#pragma once
+
+#include "memvar.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <limits>
+#include <system_error>
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+namespace detail
+{
+// the values of a cold segment are encoded oldest first, each as the
+// difference between its delta from the previous value and the previous
+// delta, zigzag encoded so that small negative differences stay small, in
+// a LEB128 varint; a run of equal deltas, as in a counter or a constant, is
+// written as a 0 followed by the length of the run
+// the arithmetic is modulo 2^64, so that any integral value round trips
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while ( value >= 0x80 ) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t getVarint(const uint8_t*& in) noexcept {
+  uint64_t value {0};
+  for (unsigned shift {0}; ; shift += 7) {
+    const uint8_t byte {*in++};
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ( 0 == (byte & 0x80) ) {
+      return value;
+    }
+  }
+}
+
+inline constexpr uint64_t zigzag(const uint64_t value) noexcept {
+  return (value << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+inline constexpr uint64_t unzigzag(const uint64_t value) noexcept {
+  return (value >> 1) ^ (0 - (value & 1));
+}
+
+// encode the values in [first, last), oldest first
+template <typename It>
+std::vector<uint8_t> encodeTieredSegment(It first, const It last) {
+  std::vector<uint8_t> out {};
+  uint64_t previous {0};
+  uint64_t previousDelta {0};
+  uint64_t run {0};
+  for (; first != last; ++first) {
+    const auto value {static_cast<uint64_t>(*first)};
+    const uint64_t delta {value - previous};
+    if ( delta == previousDelta ) {
+      ++run;
+    }
+    else {
+      if ( run > 0 ) {
+        out.push_back(0);
+        putVarint(out, run);
+        run = 0;
+      }
+      putVarint(out, zigzag(delta - previousDelta));
+    }
+    previous = value;
+    previousDelta = delta;
+  }
+  if ( run > 0 ) {
+    out.push_back(0);
+    putVarint(out, run);
+  }
+  out.shrink_to_fit();
+  return out;
+}
+
+// decode count values to out, oldest first
+template <typename T>
+void decodeTieredSegment(const uint8_t* in, const size_t count, T* out) noexcept {
+  uint64_t previous {0};
+  uint64_t delta {0};
+  for (size_t i {0}; i < count; ) {
+    const auto token {getVarint(in)};
+    auto run {uint64_t {1}};
+    if ( 0 == token ) {
+      run = getVarint(in);
+    }
+    else {
+      delta += unzigzag(token);
+    }
+    for (; run > 0; --run, ++i) {
+      previous += delta;
+      out[i] = static_cast<T>(previous);
+    }
+  }
+}
+}  // namespace detail
+
+// memvarTiered
+// a memvar for deep histories of integral values: the newest values are
+// kept as they are in a hot tier, and the older ones are sealed, a segment
+// of values at a time, into compressed immutable segments, the cold tier
+// a write costs as in a memvar but once per segment, when the oldest
+// segment of the hot tier is sealed; the reads in the hot tier cost as in
+// a memvar, a read in the cold tier decodes its segment, and the last
+// segment decoded is cached
+// the cold segments are kept in memory or, given a spill directory, written
+// to an unnamed file created there, that goes away with the memvar; the
+// space of the segments evicted from the history is given back to the file
+// system
+template <std::integral T>
+class memvarTiered : public memvarBase {
+ public:
+  using historyValue = std::tuple<T, bool>;
+
+  static constexpr size_t hotCapacityDefault_ {4'096};
+  static constexpr size_t segmentSizeDefault_ {4'096};
+
+  memvarTiered() :
+  memvarTiered(T{}, historyCapacityDefault_)
+  {}
+
+  // the hot tier holds hotCapacity values at least, segmentSize values more
+  // at most: the values sealed at once in a cold segment
+  explicit memvarTiered(const T& value,
+                        const capacityType historyCapacity = historyCapacityDefault_,
+                        const size_t hotCapacity = hotCapacityDefault_,
+                        const size_t segmentSize = segmentSizeDefault_,
+                        const std::string& spillDirectory = {}) :
+  memvarBase(historyCapacity),
+  hotCapacity_ (std::max<size_t>(hotCapacity, 1)),
+  segmentSize_ (std::max<size_t>(segmentSize, 1)) {
+    checkHistoryCapacity(historyCapacity_);
+    if ( !spillDirectory.empty() ) {
+      openSpill(spillDirectory);
+    }
+    setValue(value);
+  }
+
+  memvarTiered(const memvarTiered& rhs) = delete;
+  memvarTiered& operator=(const memvarTiered& rhs) = delete;
+  memvarTiered(memvarTiered&& rhs) = delete;
+  memvarTiered& operator=(memvarTiered&& rhs) = delete;
+
+  ~memvarTiered() override {
+    if ( -1 != fd_ ) {
+      ::close(fd_);
+    }
+  }
+
+  memvarTiered& operator=(const T& rhs) {
+    setValue(rhs);
+    return *this;
+  }
+
+  operator T() const {
+    return hot_.front();
+  }
+
+  T operator()() const {
+    return hot_.front();
+  }
+
+  T operator()(const capacityType index) const {
+    return std::get<T>(getHistoryValue(index));
+  }
+
+  // the index counts back from the newest value, as in a memvar, across the
+  // hot and the cold tiers
+  auto getHistoryValue(const capacityType index) const -> historyValue {
+    if ( (index < 0) || (index >= getHistorySize()) ) {
+      return std::make_tuple(T{}, true);
+    }
+    const auto i {static_cast<size_t>(index)};
+    if ( i < hot_.size() ) {
+      return std::make_tuple(hot_[i], false);
+    }
+    const auto j {i - hot_.size()};
+    const auto& values {decode(cold_[j / segmentSize_])};
+    return std::make_tuple(values[segmentSize_ - 1 - j % segmentSize_], false);
+  }
+
+  capacityType getHistorySize() const noexcept {
+    return static_cast<capacityType>(hot_.size() + cold_.size() * segmentSize_ - evicted_);
+  }
+
+  auto isHistoryFull() const noexcept {
+    return getHistorySize() >= historyCapacity_;
+  }
+
+  // the number of values in the hot tier
+  size_t getHotSize() const noexcept {
+    return hot_.size();
+  }
+
+  size_t getSegmentCount() const noexcept {
+    return cold_.size();
+  }
+
+  // the bytes of the compressed cold segments, in memory or spilled
+  uint64_t getColdBytes() const noexcept {
+    return coldBytes_;
+  }
+
+  bool isSpilled() const noexcept {
+    return -1 != fd_;
+  }
+
+  // call f with each value, from the oldest value to the newest one
+  template <typename F>
+  void forEach(F&& f) const {
+    std::vector<T> values (segmentSize_);
+    for (auto it {cold_.crbegin()}; it != cold_.crend(); ++it) {
+      loadSegment(*it, values.data());
+      for (auto i {(it == cold_.crbegin()) ? evicted_ : 0}; i < segmentSize_; ++i) {
+        f(values[i]);
+      }
+    }
+    for (auto it {hot_.crbegin()}; it != hot_.crend(); ++it) {
+      f(*it);
+    }
+  }
+
+  // change the history capacity keeping the history: shrinking evicts the
+  // oldest values that do not fit the new capacity
+  void setHistoryCapacity(const capacityType historyCapacity) {
+    checkHistoryCapacity(historyCapacity);
+    while ( getHistorySize() > historyCapacity ) {
+      evictOldest();
+    }
+    historyCapacity_ = historyCapacity;
+  }
+
+  void clearHistory() {
+    hot_.clear();
+    cold_.clear();
+    evicted_ = 0;
+    coldBytes_ = 0;
+    cachedFirst_ = noSegment_;
+    if ( isSpilled() ) {
+      spillEnd_ = 0;
+      if ( -1 == ::ftruncate(fd_, 0) ) {
+        throw std::system_error(errno, std::generic_category(), "ftruncate " + spillPath_);
+      }
+    }
+    setValue(T{});
+  }
+
+ private:
+  static constexpr uint64_t noSegment_ {std::numeric_limits<uint64_t>::max()};
+
+  // an unnamed file in directory, or where the file system does not support
+  // O_TMPFILE a file with a new unique name, unlinked at once: no file there
+  // is ever opened or removed but the one created here
+  void openSpill(const std::string& directory) {
+    spillPath_ = directory;
+#ifdef O_TMPFILE
+    fd_ = ::open(directory.c_str(), O_RDWR | O_TMPFILE | O_CLOEXEC, 0600);
+    if ( -1 != fd_ ) {
+      return;
+    }
+    if ( (EOPNOTSUPP != errno) && (EISDIR != errno) && (EINVAL != errno) ) {
+      throw std::system_error(errno, std::generic_category(), "open " + directory);
+    }
+#endif
+    std::string name {directory + "/memvarTiered-XXXXXX"};
+    fd_ = ::mkstemp(name.data());
+    if ( -1 == fd_ ) {
+      throw std::system_error(errno, std::generic_category(), "mkstemp " + name);
+    }
+    ::unlink(name.c_str());
+    ::fcntl(fd_, F_SETFD, FD_CLOEXEC);
+  }
+
+  struct segment {
+    // the write number of the oldest value, identifying the segment
+    uint64_t first_ {0};
+    // the encoded values, or where they are in the spill file
+    std::vector<uint8_t> bytes_ {};
+    uint64_t offset_ {0};
+    uint64_t size_ {0};
+  };
+
+  const size_t hotCapacity_;
+  const size_t segmentSize_;
+  // newest value first
+  std::deque<T> hot_ {};
+  // newest segment first; the evicted_ oldest values of the oldest segment
+  // are out of the history
+  std::deque<segment> cold_ {};
+  size_t evicted_ {0};
+  uint64_t coldBytes_ {0};
+  uint64_t writes_ {0};
+  int fd_ {-1};
+  // the spill directory, for the error messages
+  std::string spillPath_ {};
+  uint64_t spillEnd_ {0};
+  mutable uint64_t cachedFirst_ {noSegment_};
+  mutable std::vector<T> cached_ {};
+
+  void setValue(const T& value) {
+    hot_.emplace_front(value);
+    ++writes_;
+    if ( hot_.size() >= hotCapacity_ + segmentSize_ ) {
+      seal();
+    }
+    if ( getHistorySize() > historyCapacity_ ) {
+      evictOldest();
+    }
+  }
+
+  // move the oldest segmentSize_ values of the hot tier to a cold segment
+  void seal() {
+    segment s {};
+    s.first_ = writes_ - hot_.size();
+    auto bytes {detail::encodeTieredSegment(hot_.crbegin(), hot_.crbegin() + static_cast<std::ptrdiff_t>(segmentSize_))};
+    s.size_ = bytes.size();
+    if ( isSpilled() ) {
+      writeAll(bytes.data(), bytes.size(), spillEnd_);
+      s.offset_ = spillEnd_;
+      spillEnd_ += bytes.size();
+    }
+    else {
+      s.bytes_ = std::move(bytes);
+    }
+    coldBytes_ += s.size_;
+    cold_.emplace_front(std::move(s));
+    hot_.erase(hot_.end() - static_cast<std::ptrdiff_t>(segmentSize_), hot_.end());
+  }
+
+  void evictOldest() {
+    if ( cold_.empty() ) {
+      hot_.pop_back();
+      return;
+    }
+    if ( ++evicted_ < segmentSize_ ) {
+      return;
+    }
+    const auto& oldest {cold_.back()};
+    if ( isSpilled() ) {
+      // best effort: the file is only a spill
+      [[maybe_unused]] const auto result {::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                                                      static_cast<off_t>(oldest.offset_),
+                                                      static_cast<off_t>(oldest.size_))};
+    }
+    if ( oldest.first_ == cachedFirst_ ) {
+      cachedFirst_ = noSegment_;
+    }
+    coldBytes_ -= oldest.size_;
+    cold_.pop_back();
+    evicted_ = 0;
+  }
+
+  const std::vector<T>& decode(const segment& s) const {
+    if ( s.first_ != cachedFirst_ ) {
+      cached_.resize(segmentSize_);
+      loadSegment(s, cached_.data());
+      cachedFirst_ = s.first_;
+    }
+    return cached_;
+  }
+
+  void loadSegment(const segment& s, T* out) const {
+    if ( !isSpilled() ) {
+      detail::decodeTieredSegment(s.bytes_.data(), segmentSize_, out);
+      return;
+    }
+    std::vector<uint8_t> bytes (s.size_);
+    size_t done {0};
+    while ( done < bytes.size() ) {
+      const auto n {::pread(fd_, bytes.data() + done, bytes.size() - done, static_cast<off_t>(s.offset_ + done))};
+      if ( n > 0 ) {
+        done += static_cast<size_t>(n);
+      }
+      else if ( !((-1 == n) && (EINTR == errno)) ) {
+        throw std::system_error((0 == n) ? EIO : errno, std::generic_category(), "read " + spillPath_);
+      }
+    }
+    detail::decodeTieredSegment(bytes.data(), segmentSize_, out);
+  }
+
+  void writeAll(const uint8_t* data, const size_t size, const uint64_t offset) {
+    size_t done {0};
+    while ( done < size ) {
+      const auto n {::pwrite(fd_, data + done, size - done, static_cast<off_t>(offset + done))};
+      if ( n > 0 ) {
+        done += static_cast<size_t>(n);
+      }
+      else if ( !((-1 == n) && (EINTR == errno)) ) {
+        throw std::system_error(errno, std::generic_category(), "write " + spillPath_);
+      }
+    }
+  }
+};  // class memvarTiered
+
+template <typename T>
+T getHistoryValue(const memvarTiered<T>& mvt, const memvarBase::capacityType index) {
+  return std::get<T>(mvt.getHistoryValue(index));
+}
+}  // namespace memvar
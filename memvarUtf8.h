@@ -0,0 +1,190 @@
+//
+// memvarUtf8.h
+//
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+////////////////////////////////////////////////////////////////////////////////
+namespace memvar
+{
+// the wide character types transcoded to UTF-8: UTF-16 for char16_t and for
+// a 16 bit wchar_t, UTF-32 for char32_t and for a 32 bit wchar_t
+template <typename CharT>
+concept WideChar = std::is_same_v<CharT, wchar_t> ||
+                   std::is_same_v<CharT, char16_t> ||
+                   std::is_same_v<CharT, char32_t>;
+
+namespace detail
+{
+template <typename CharT>
+inline constexpr bool isUtf16_ {sizeof(CharT) == 2};
+
+// the code point written in place of a lone surrogate or of a value that is
+// not a code point
+inline constexpr char32_t replacementCharacter {0xfffd};
+
+// the number of code units copied at once when they are all ASCII
+inline constexpr size_t asciiBlockSize {16};
+
+// copy a block of asciiBlockSize code units to out if they are all ASCII
+template <typename CharT>
+inline bool copyAsciiBlock(const CharT* in, char* out) noexcept {
+#if defined(__SSE2__)
+  const __m128i zero {_mm_setzero_si128()};
+  if constexpr ( isUtf16_<CharT> ) {
+    const __m128i a {_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))};
+    const __m128i b {_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8))};
+    const __m128i high {_mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xff80)))};
+    if ( 0xffff != _mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) ) {
+      return false;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+  }
+  else {
+    const __m128i a {_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))};
+    const __m128i b {_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4))};
+    const __m128i c {_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8))};
+    const __m128i d {_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12))};
+    const __m128i high {_mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+                                      _mm_set1_epi32(static_cast<int>(0xffffff80)))};
+    if ( 0xffff != _mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) ) {
+      return false;
+    }
+    // all the values are below 0x80: the saturating packs keep them as they are
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+  }
+  return true;
+#else
+  std::uint32_t high {0};
+  for (size_t i {0}; i < asciiBlockSize; ++i) {
+    high |= static_cast<std::uint32_t>(in[i]);
+  }
+  if ( high >= 0x80 ) {
+    return false;
+  }
+  for (size_t i {0}; i < asciiBlockSize; ++i) {
+    out[i] = static_cast<char>(in[i]);
+  }
+  return true;
+#endif
+}
+
+inline char* encodeUtf8(const char32_t c, char* out) noexcept {
+  if ( c < 0x80 ) {
+    *out++ = static_cast<char>(c);
+  }
+  else if ( c < 0x800 ) {
+    *out++ = static_cast<char>(0xc0 | (c >> 6));
+    *out++ = static_cast<char>(0x80 | (c & 0x3f));
+  }
+  else if ( c < 0x10000 ) {
+    *out++ = static_cast<char>(0xe0 | (c >> 12));
+    *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+    *out++ = static_cast<char>(0x80 | (c & 0x3f));
+  }
+  else {
+    *out++ = static_cast<char>(0xf0 | (c >> 18));
+    *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+    *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+    *out++ = static_cast<char>(0x80 | (c & 0x3f));
+  }
+  return out;
+}
+
+// decode the code point at first, a surrogate pair taking two code units
+template <typename CharT>
+inline char32_t decodeCodePoint(const CharT*& first, const CharT* last) noexcept {
+  const auto c {static_cast<char32_t>(static_cast<std::make_unsigned_t<CharT>>(*first++))};
+  if ( (c >= 0xd800) && (c < 0xe000) ) {
+    if constexpr ( isUtf16_<CharT> ) {
+      if ( (c < 0xdc00) && (first != last) ) {
+        const auto low {static_cast<char32_t>(static_cast<std::make_unsigned_t<CharT>>(*first))};
+        if ( (low >= 0xdc00) && (low < 0xe000) ) {
+          ++first;
+          return 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+        }
+      }
+    }
+    return replacementCharacter;
+  }
+  return (c < 0x110000) ? c : replacementCharacter;
+}
+}  // namespace detail
+
+// the most bytes of UTF-8 for size code units: 3 for a UTF-16 code unit,
+// 4 for a surrogate pair, 4 for a UTF-32 code unit
+template <WideChar CharT>
+constexpr size_t utf8MaxSize(const size_t size) noexcept {
+  return size * (detail::isUtf16_<CharT> ? 3 : 4);
+}
+
+// transcode text to UTF-8 at out, that has room for utf8MaxSize(text.size())
+// bytes, and return the end of the UTF-8 text
+// the runs of ASCII characters are copied a block at a time; the lone
+// surrogates and the values that are not code points are written as U+FFFD
+template <WideChar CharT>
+char* toUtf8(const std::basic_string_view<CharT> text, char* out) noexcept {
+  const CharT* first {text.data()};
+  const CharT* const last {first + text.size()};
+  while ( first != last ) {
+    if ( (static_cast<size_t>(last - first) >= detail::asciiBlockSize) &&
+         (static_cast<std::make_unsigned_t<CharT>>(*first) < 0x80) &&
+         detail::copyAsciiBlock(first, out) ) {
+      first += detail::asciiBlockSize;
+      out += detail::asciiBlockSize;
+      continue;
+    }
+    out = detail::encodeUtf8(detail::decodeCodePoint(first, last), out);
+  }
+  return out;
+}
+
+// the number of code units at the front of text whose UTF-8 fits size
+// bytes, without splitting a surrogate pair: used to transcode a long text
+// a chunk at a time into a fixed buffer
+template <WideChar CharT>
+size_t utf8ChunkSize(const std::basic_string_view<CharT> text, const size_t size) noexcept {
+  auto units {std::min(text.size(), size / utf8MaxSize<CharT>(1))};
+  if constexpr ( detail::isUtf16_<CharT> ) {
+    if ( (units > 1) && (units < text.size()) &&
+         (text[units - 1] >= 0xd800) && (text[units - 1] < 0xdc00) ) {
+      --units;
+    }
+  }
+  return units;
+}
+
+// append text transcoded to UTF-8 to out: a converter reusing the capacity
+// of out across the calls
+template <WideChar CharT>
+std::string& appendUtf8(std::string& out, const std::basic_string_view<CharT> text) {
+  const auto size {out.size()};
+  out.resize(size + utf8MaxSize<CharT>(text.size()));
+  out.resize(static_cast<size_t>(toUtf8(text, out.data() + size) - out.data()));
+  return out;
+}
+
+// write text transcoded to UTF-8 to os, a chunk at a time through a buffer
+// on the stack
+template <WideChar CharT>
+std::ostream& writeUtf8(std::ostream& os, std::basic_string_view<CharT> text) {
+  char buffer[1024];
+  while ( !text.empty() ) {
+    const auto units {utf8ChunkSize(text, sizeof(buffer))};
+    const char* const end {toUtf8(text.substr(0, units), buffer)};
+    os.write(buffer, end - buffer);
+    text.remove_prefix(units);
+  }
+  return os;
+}
+}  // namespace memvar
@@ -3,9 +3,554 @@
 //
 #include "perfTest.h"
 #include "../memvar.h"
+#include "../memvarCoro.h"
+#include "../memvarRegistry.h"
+#include "../memvarLog.h"
+#include "../memvarFile.h"
+#include "../memvarExport.h"
+#include "../memvarArrow.h"
+#include "../memvarTiered.h"
+#include "../memvarRollup.h"
+#include "../memvarRangeIndex.h"
 
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <codecvt>
+#include <locale>
+////////////////////////////////////////////////////////////////////////////////
+// sum the values of an update stream until it is closed
+memvar::task sumUpdates(memvar::updateStream<int64_t>& stream, int64_t& total) {
+  while ( auto value = co_await stream.next() ) {
+    total += *value;
+  }
+}
+
+// fan-in of many memvars into coroutines running on one event loop
+void coroutineFanInPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr size_t memvars {10'000};
+  constexpr memvarType rounds {1'000};
+
+  memvar::eventLoop loop {};
+  std::vector<memvar::memvar<memvarType>> mvs {};
+  std::vector<memvar::updateStream<memvarType>> streams {};
+  memvarType total {0};
+
+  mvs.reserve(memvars);
+  streams.reserve(memvars);
+  for (size_t i {0}; i < memvars; ++i) {
+    mvs.emplace_back(0, 16);
+    streams.emplace_back(memvar::updates(mvs.back(), loop));
+    loop.spawn(sumUpdates(streams.back(), total));
+  }
+  loop.run();
+
+  auto fanIn = [&mvs, &loop] () {
+    for (memvarType r {1}; r <= rounds; ++r) {
+      for (auto& mv : mvs) {
+        mv = r;
+      }
+      loop.run();
+    }
+  };
+
+  const auto timeSpan = perftimer::duration(fanIn).count();
+
+  streams.clear();
+  loop.run();
+
+  // each memvar gets 1 + 2 + ... + rounds
+  std::cout << "coroutine fan-in of " << memvars << " memvars, total: " << total
+            << " (expected: " << static_cast<memvarType>(memvars) * rounds * (rounds + 1) / 2 << ")"
+            << "\n" << memvars * rounds << " updates took: " << timeSpan << " sec - "
+            << std::fixed << std::setprecision(4)
+            << static_cast<double>(memvars * rounds) / timeSpan
+            << " updates resumed per second\n"
+            << "tasks left: " << loop.getTaskCount() << "\n\n" << std::defaultfloat;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// create a million named memvars, then look them up from all the cores
+void registryPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr size_t memvars {1'000'000};
+  const size_t threadCount {std::max(1U, std::thread::hardware_concurrency())};
+
+  memvar::memvarRegistry<memvar::memvarConcurrent<memvarType>> registry {};
+  std::vector<std::string> names {};
+  names.reserve(memvars);
+  for (size_t i {0}; i < memvars; ++i) {
+    names.push_back("memvar." + std::to_string(i));
+  }
+
+  auto create = [&registry, &names, threadCount] () {
+    std::vector<std::jthread> threads {};
+    for (size_t t {0}; t < threadCount; ++t) {
+      threads.emplace_back([&registry, &names, threadCount, t] () {
+        for (auto i {t}; i < names.size(); i += threadCount) {
+          registry.getOrCreate(names[i], static_cast<memvarType>(i), 2);
+        }
+      });
+    }
+  };
+  std::atomic<memvarType> total {0};
+  auto lookup = [&registry, &names, &total, threadCount] () {
+    std::vector<std::jthread> threads {};
+    for (size_t t {0}; t < threadCount; ++t) {
+      threads.emplace_back([&registry, &names, &total, threadCount, t] () {
+        memvarType sum {0};
+        for (auto i {t}; i < names.size(); i += threadCount) {
+          sum += (*registry.find(names[i]))();
+        }
+        total += sum;
+      });
+    }
+  };
+  std::atomic<memvarType> dumped {0};
+  auto dump = [&registry, &dumped] () {
+    registry.parallelForEach([&dumped] (const std::string&, const memvar::memvarConcurrent<memvarType>& mvc) {
+      dumped.fetch_add(mvc(), std::memory_order_relaxed);
+    });
+  };
+
+  const auto createSpan = perftimer::duration(create).count();
+  const auto lookupSpan = perftimer::duration(lookup).count();
+  const auto dumpSpan = perftimer::duration(dump).count();
+
+  std::cout << "registry of " << registry.size() << " memvars on " << threadCount << " threads\n"
+            << std::fixed << std::setprecision(4)
+            << "creation took: " << createSpan << " sec - "
+            << static_cast<double>(memvars) / createSpan << " creations per second\n"
+            << "lookup took: " << lookupSpan << " sec - "
+            << static_cast<double>(memvars) / lookupSpan << " lookups per second\n"
+            << "parallel iteration took: " << dumpSpan << " sec\n"
+            << "totals: " << total << " " << dumped
+            << " (expected: " << static_cast<memvarType>(memvars) * (memvars - 1) / 2 << ")\n\n"
+            << std::defaultfloat;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write to a memvar streamed to a log by a background thread
+void persisterPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvarType writes {10'000'000};
+  const auto path {(std::filesystem::temp_directory_path() / "memvar-perf-test.log").string()};
+  std::filesystem::remove(path);
+
+  memvar::memvarTimed<memvarType> mvt {0, 1'000};
+  memvar::memvarPersister<memvarType> persister {mvt, path};
+
+  auto write = [&mvt] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvt = i;
+    }
+  };
+  const auto writeSpan = perftimer::duration(write).count();
+  const auto flushSpan = perftimer::duration([&persister] () { persister.flush(); }).count();
+
+  std::cout << "persisted " << persister.getPersistedCount() << " values to " << path << "\n"
+            << std::fixed << std::setprecision(4)
+            << "writes took: " << writeSpan << " sec - "
+            << static_cast<double>(writes) / writeSpan << " writes per second, "
+            << persister.getStallCount() << " stalls on a full ring\n"
+            << "final flush took: " << flushSpan << " sec\n\n"
+            << std::defaultfloat;
+  std::filesystem::remove(path);
+}
+
+// the same writes through a write-ahead log with group commit
+void walPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvarType writes {1'000'000};
+  const auto path {(std::filesystem::temp_directory_path() / "memvar-perf-test.wal").string()};
+  std::filesystem::remove(path);
+
+  memvar::memvarTimed<memvarType> mvt {0, 1'000};
+  memvar::memvarPersister<memvarType> persister {mvt, path,
+                                                 memvar::memvarPersister<memvarType>::ringCapacityDefault_,
+                                                 memvar::memvarPersister<memvarType>::flushIntervalDefault_,
+                                                 memvar::logSyncPolicy {8'192, std::chrono::microseconds {1'000}}};
+
+  auto write = [&mvt] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvt = i;
+    }
+  };
+  const auto writeSpan = perftimer::duration(write).count();
+  const auto syncSpan = perftimer::duration([&persister] () { persister.sync(); }).count();
+
+  std::cout << "made " << persister.getDurableCount() << " values durable in " << persister.getSyncCount()
+            << " group commits to " << path << "\n"
+            << std::fixed << std::setprecision(4)
+            << "writes took: " << writeSpan << " sec - "
+            << static_cast<double>(writes) / writeSpan << " writes per second, "
+            << persister.getStallCount() << " stalls on a full ring\n"
+            << "final sync took: " << syncSpan << " sec\n\n"
+            << std::defaultfloat;
+  std::filesystem::remove(path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// save a history, then load it in place and by parsing it
+void historyFilePerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvar::memvarBase::capacityType historyCapacity {10'000'000};
+  const auto path {(std::filesystem::temp_directory_path() / "memvar-perf-test.mvh").string()};
+
+  memvar::memvarTimed<memvarType> mvt {0, historyCapacity};
+  for (memvarType i {1}; i < historyCapacity; ++i) {
+    mvt = i;
+  }
+
+  const auto saveSpan = perftimer::duration([&path, &mvt] () { memvar::saveHistory(path, mvt); }).count();
+  memvarType sum {0};
+  const auto mapSpan = perftimer::duration([&path, &sum] () {
+    const memvar::mappedHistory<memvarType> mapped {path};
+    sum = mapped() + mapped(mapped.getHistorySize() - 1);
+  }).count();
+  memvar::memvarTimed<memvarType> restored {0, historyCapacity};
+  const auto loadSpan = perftimer::duration([&path, &restored] () { memvar::loadHistory(path, restored); }).count();
+
+  std::cout << "history file of " << historyCapacity << " timed values, first + last: " << sum
+            << " (expected: " << historyCapacity - 1 << ")\n"
+            << std::fixed << std::setprecision(4)
+            << "save took: " << saveSpan << " sec\n"
+            << "mapped load took: " << mapSpan << " sec\n"
+            << "parsed load took: " << loadSpan << " sec\n\n"
+            << std::defaultfloat;
+  std::filesystem::remove(path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// export a history as text: one ostream insertion per item, as the printers
+// used to do, against the buffered export
+void exportPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvar::memvarBase::capacityType historyCapacity {10'000'000};
+  const auto path {(std::filesystem::temp_directory_path() / "memvar-perf-test.txt").string()};
+
+  memvar::memvarTimed<memvarType> mvt {0, historyCapacity};
+  for (memvarType i {1}; i < historyCapacity; ++i) {
+    mvt = i * 7'919;
+  }
+
+  auto streamed = [&path, &mvt] () {
+    std::ofstream os {path};
+    for (size_t i {0}; i < static_cast<size_t>(mvt.getHistorySize()); ++i) {
+      os << mvt.getTimeTag(i).count() << "," << mvt(static_cast<memvar::memvarBase::capacityType>(i)) << "\n";
+    }
+  };
+  auto exported = [&path, &mvt] () {
+    memvar::exportHistory(path, mvt, memvar::exportFormat::csv);
+  };
+  const auto streamedSpan = perftimer::duration(streamed).count();
+  const auto exportedSpan = perftimer::duration(exported).count();
+  const auto bytes {std::filesystem::file_size(path)};
+
+  std::cout << "csv export of " << historyCapacity << " timed values, " << bytes << " bytes\n"
+            << std::fixed << std::setprecision(4)
+            << "ostream per item took: " << streamedSpan << " sec\n"
+            << "buffered export took: " << exportedSpan << " sec - "
+            << static_cast<double>(bytes) / exportedSpan / 1'000'000.0 << " MB per second, "
+            << streamedSpan / exportedSpan << " times faster\n\n"
+            << std::defaultfloat;
+  std::filesystem::remove(path);
+}
+
+void arrowPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvar::memvarBase::capacityType historyCapacity {10'000'000};
+  const auto path {(std::filesystem::temp_directory_path() / "memvar-perf-test.arrow").string()};
+
+  memvar::memvarTimed<memvarType> mvt {0, historyCapacity};
+  for (memvarType i {1}; i < historyCapacity; ++i) {
+    mvt = i * 7'919;
+  }
+
+  auto csv = [&path, &mvt] () {
+    memvar::exportHistory(path, mvt, memvar::exportFormat::csv, memvar::historyOrder::oldestFirst);
+  };
+  auto arrow = [&path, &mvt] () {
+    memvar::exportArrow(path, mvt);
+  };
+  const auto csvSpan = perftimer::duration(csv).count();
+  const auto arrowSpan = perftimer::duration(arrow).count();
+  const auto bytes {std::filesystem::file_size(path)};
+
+  std::cout << "arrow export of " << historyCapacity << " timed values, " << bytes << " bytes\n"
+            << std::fixed << std::setprecision(4)
+            << "csv export took: " << csvSpan << " sec\n"
+            << "arrow export took: " << arrowSpan << " sec - "
+            << static_cast<double>(bytes) / arrowSpan / 1'000'000.0 << " MB per second, "
+            << csvSpan / arrowSpan << " times faster\n\n"
+            << std::defaultfloat;
+  std::filesystem::remove(path);
+}
+
+// a deep history kept by a memvar and by a memvarTiered
+void tieredPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvar::memvarBase::capacityType historyCapacity {10'000'000};
+  // a counter moving by a few units at a time
+  auto valueAt = [] (const memvarType i) { return i * 3 + (i % 16 == 0 ? 2 : 0); };
+
+  memvar::memvar<memvarType> mv {0, historyCapacity};
+  memvar::memvarTiered<memvarType> mvt {0, historyCapacity};
+  const auto memvarSpan = perftimer::duration([&mv, &valueAt] () {
+    for (memvarType i {1}; i < historyCapacity; ++i) {
+      mv = valueAt(i);
+    }
+  }).count();
+  const auto tieredSpan = perftimer::duration([&mvt, &valueAt] () {
+    for (memvarType i {1}; i < historyCapacity; ++i) {
+      mvt = valueAt(i);
+    }
+  }).count();
+
+  memvarType sum {0};
+  constexpr memvar::memvarBase::capacityType reads {1'000'000};
+  const auto hotSpan = perftimer::duration([&mvt, &sum] () {
+    for (memvar::memvarBase::capacityType i {0}; i < reads; ++i) {
+      sum += mvt(i % 4'096);
+    }
+  }).count();
+  const auto coldSpan = perftimer::duration([&mvt, &sum] () {
+    for (memvar::memvarBase::capacityType i {0}; i < reads; ++i) {
+      sum += mvt(historyCapacity - 1 - i);
+    }
+  }).count();
+
+  const auto memvarBytes {static_cast<double>(historyCapacity) * sizeof(memvarType)};
+  const auto tieredBytes {static_cast<double>(mvt.getColdBytes() + mvt.getHotSize() * sizeof(memvarType))};
+  std::cout << "history of " << historyCapacity << " values, sum: " << sum << "\n"
+            << std::fixed << std::setprecision(4)
+            << "memvar writes took: " << memvarSpan << " sec, " << memvarBytes / 1'000'000.0 << " MB of values\n"
+            << "memvarTiered writes took: " << tieredSpan << " sec, " << tieredBytes / 1'000'000.0 << " MB of values in "
+            << mvt.getSegmentCount() << " segments - " << memvarBytes / tieredBytes << " times smaller\n"
+            << reads << " hot reads took: " << hotSpan << " sec, "
+            << reads << " sequential cold reads took: " << coldSpan << " sec\n\n"
+            << std::defaultfloat;
+}
+
+void rangeIndexPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvar::memvarBase::capacityType historyCapacity {1'000'000};
+  constexpr memvarType writes {10'000'000};
+  auto valueAt = [] (const memvarType i) { return (i * 2'654'435'761) % 1'000'003; };
+  memvar::memvar<memvarType> mv {0, historyCapacity};
+  const auto memvarSpan = perftimer::duration([&mv, &valueAt] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mv = valueAt(i);
+    }
+  }).count();
+  memvar::memvar<memvarType> mvi {0, historyCapacity};
+  memvar::memvarRangeIndex<memvarType> index {mvi};
+  const auto indexSpan = perftimer::duration([&mvi, &valueAt] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvi = valueAt(i);
+    }
+  }).count();
+
+  // the max over the last k values, for many different k
+  constexpr int queries {1'000};
+  memvarType sum {0};
+  const auto scanSpan = perftimer::duration([&mv, &sum] () {
+    const auto& history {mv.getMemVarHistory()};
+    for (int q {1}; q <= queries; ++q) {
+      sum += *std::max_element(history.cbegin(), history.cbegin() + q * 997);
+    }
+  }).count();
+  const auto querySpan = perftimer::duration([&index, &sum] () {
+    for (int q {1}; q <= queries; ++q) {
+      sum -= std::get<1>(index.getLastMinMax(q * 997));
+    }
+  }).count();
+
+  std::cout << writes << " writes took: " << memvarSpan << " sec\n"
+            << writes << " writes with a range index took: " << indexSpan << " sec\n"
+            << queries << " scans for the max of the last k values took: " << scanSpan << " sec\n"
+            << queries << " range index queries took: " << querySpan << " sec - "
+            << scanSpan / querySpan << " times faster (" << sum << ")\n\n";
+}
+
+void samplingPerfTest () {
+  using memvarType = int64_t;
+
+  constexpr memvarType writes {100'000'000};
+  constexpr memvar::memvarBase::capacityType historyCapacity {1'000'000};
+  auto run = [] (memvar::memvar<memvarType>& mv) {
+    return perftimer::duration([&mv] () {
+      for (memvarType i {1}; i <= writes; ++i) {
+        mv = i;
+      }
+    }).count();
+  };
+  memvar::memvar<memvarType> mv {0, historyCapacity};
+  const auto allSpan {run(mv)};
+  memvar::memvar<memvarType> mvn {0, historyCapacity};
+  mvn.setSampling(memvar::sampling::everyNth, 100);
+  const auto nthSpan {run(mvn)};
+  memvar::memvar<memvarType> mvr {0, historyCapacity};
+  mvr.setSampling(memvar::sampling::reservoir);
+  const auto reservoirSpan {run(mvr)};
+
+  std::cout << writes << " writes took: " << allSpan << " sec, the history goes back "
+            << mv() - mv(historyCapacity - 1) << " writes\n"
+            << writes << " writes keeping every 100th took: " << nthSpan << " sec, the history goes back "
+            << mvn() - mvn(mvn.getHistorySize() - 1) << " writes - " << allSpan / nthSpan << " times faster\n"
+            << writes << " writes keeping a reservoir took: " << reservoirSpan << " sec, the history goes back "
+            << mvr() - mvr(mvr.getHistorySize() - 1) << " writes in " << mvr.getHistorySize() << " values - " << allSpan / reservoirSpan << " times faster\n\n";
+}
+
+void changeOnlyPerfTest () {
+  using memvarType = int64_t;
+
+  // a reading that changes every 100 writes
+  constexpr memvarType writes {100'000'000};
+  constexpr memvar::memvarBase::capacityType historyCapacity {1'000'000};
+  memvar::memvar<memvarType> mv {0, historyCapacity};
+  memvar::memvar<memvarType> mvc {0, historyCapacity};
+  mvc.setChangeOnly(true);
+  const auto memvarSpan = perftimer::duration([&mv] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mv = i / 100;
+    }
+  }).count();
+  const auto changeOnlySpan = perftimer::duration([&mvc] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvc = i / 100;
+    }
+  }).count();
+
+  std::cout << writes << " writes took: " << memvarSpan << " sec, the history goes back "
+            << mv() - mv(historyCapacity - 1) << " changes\n"
+            << writes << " writes in change only mode took: " << changeOnlySpan << " sec, the history goes back "
+            << mvc() - mvc(historyCapacity - 1) << " changes - "
+            << memvarSpan / changeOnlySpan << " times faster\n\n";
+}
+
+void retentionPerfTest () {
+  using namespace std::chrono_literals;
+  using memvarType = int64_t;
+  using mvtType = memvar::memvarTimed<memvarType>;
+
+  // bursts of 100'000 values in 100 ms, a burst a second
+  constexpr memvarType writes {10'000'000};
+  auto when = [] (const memvarType i) { return mvtType::timePoint {} + (i / 100'000) * 1s + (i % 100'000) * 1us; };
+  mvtType mvt {0, 1'000'000};
+  const auto capacitySpan = perftimer::duration([&mvt, &when] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvt.setValueAt(i, when(i));
+    }
+  }).count();
+  // the last 2 seconds, capped at 1'000'000 values
+  mvtType mvtr {0, 1'000'000};
+  mvtr.setRetention(2s);
+  const auto retentionSpan = perftimer::duration([&mvtr, &when] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvtr.setValueAt(i, when(i));
+    }
+  }).count();
+
+  std::cout << writes << " timed writes with a capacity of 1000000 values took: " << capacitySpan << " sec, "
+            << mvt.getHistorySize() << " values kept\n"
+            << writes << " timed writes with a retention of 2 sec took: " << retentionSpan << " sec, "
+            << mvtr.getHistorySize() << " values kept\n\n";
+}
+
+void rollupPerfTest () {
+  using namespace std::chrono_literals;
+  using memvarType = int64_t;
+  using mvtType = memvar::memvarTimed<memvarType>;
+
+  constexpr memvarType writes {10'000'000};
+  // a value every millisecond: 10'000 seconds, almost 3 hours
+  const mvtType::timePoint start {};
+  mvtType mvt {0, 100'000};
+  const auto timedSpan = perftimer::duration([&mvt, &start] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvt.setValueAt(i % 1'000, start + i * 1ms);
+    }
+  }).count();
+  mvtType mvtr {0, 100'000};
+  memvar::memvarRollup<memvarType> rollup {mvtr};
+  const auto rollupSpan = perftimer::duration([&mvtr, &start] () {
+    for (memvarType i {1}; i <= writes; ++i) {
+      mvtr.setValueAt(i % 1'000, start + i * 1ms);
+    }
+  }).count();
+
+  // a day long range read back from the minutes instead of the values
+  const auto now {mvtr.getTimePoint()};
+  decltype(rollup.query(now, now)) result {};
+  constexpr int queries {10'000};
+  const auto querySpan = perftimer::duration([&rollup, &result, &now] () {
+    for (int i {0}; i < queries; ++i) {
+      result = rollup.query(now - 24h, now);
+    }
+  }).count();
+
+  std::cout << writes << " timed writes took: " << timedSpan << " sec\n"
+            << writes << " timed writes with 2 rollup tiers took: " << rollupSpan << " sec - "
+            << (rollupSpan - timedSpan) / writes * 1e9 << " ns more per write\n"
+            << queries << " queries of " << result.buckets_.size() << " buckets of "
+            << std::chrono::duration_cast<std::chrono::seconds>(result.resolution_).count() << " sec took: "
+            << querySpan << " sec\n\n";
+}
+
+void utf8PerfTest () {
+  constexpr memvar::memvarBase::capacityType historyCapacity {1'000'000};
+
+  memvar::memvar<std::u16string> mv {u"", historyCapacity};
+  for (memvar::memvarBase::capacityType i {0}; i < historyCapacity; ++i) {
+    mv = (i % 4 == 0) ? u"temp\u00e9rature capteur " + std::u16string(i % 10 + 1, u'x')
+                      : u"sensor reading number " + std::u16string(i % 10 + 1, u'x');
+  }
+
+  std::string sink {};
+  auto converted = [&mv, &sink] () {
+    for (const auto& value : mv.getMemVarHistory()) {
+      // the way operator<< used to transcode a value
+      std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> conv;
+      sink += conv.to_bytes(value);
+    }
+  };
+  auto transcoded = [&mv, &sink] () {
+    for (const auto& value : mv.getMemVarHistory()) {
+      memvar::appendUtf8(sink, std::u16string_view(value));
+    }
+  };
+  const auto convertedSpan = perftimer::duration(converted).count();
+  const auto bytes {sink.size()};
+  sink.clear();
+  const auto transcodedSpan = perftimer::duration(transcoded).count();
+  if ( bytes != sink.size() ) {
+    std::cout << "utf8 transcoding mismatch\n";
+  }
+
+  std::cout << "utf-16 to utf-8 of " << historyCapacity << " values, " << bytes << " bytes\n"
+            << std::fixed << std::setprecision(4)
+            << "wstring_convert per value took: " << convertedSpan << " sec\n"
+            << "memvar::appendUtf8 took: " << transcodedSpan << " sec - "
+            << convertedSpan / transcodedSpan << " times faster\n\n"
+            << std::defaultfloat;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void perfTest () {
   using memvarType = int64_t;
@@ -192,10 +737,69 @@ void perfTest () {
 
   //////////////////////////////////////////////////////////////////////////////
 
+  duration_secs = perftimer::duration(clearHistory);
+  std::cout << "clearing history took: " << duration_secs.count() << " sec (" << perftimer::to_msec(duration_secs) << " msec)\n\n";
+
+  // load the history in blocks through the bulk append api
+  constexpr size_t blockSize {1'000'000};
+  std::vector<memvarType> block (blockSize);
+
+  auto bulkAppend = [&mv, &block] () noexcept {
+    memvarType c {0};
+    while ( !mv.isHistoryFull() ) {
+      for (auto& v : block) {
+        v = ++c;
+      }
+      mv.append(block);
+    }
+  };
+
+  timeSpan = perftimer::duration(bulkAppend).count();
+
+  // display the last 10 values stored
+  for (int i {0}; i < 10; ++i) {
+    std::cout << i << ": " << mv(i) << "\n";
+  }
+
+  std::cout << "\nbulk append of blocks of " << blockSize << " values took: " << timeSpan << " sec - "
+            << std::fixed << std::setprecision(4)
+            << static_cast<double>(historyCapacity) / timeSpan
+            << " int64 appended per second\n\n";
+
+  // export the newest values of the history in blocks
+  auto bulkExport = [&mv, &block] () noexcept {
+    for (int i {0}; i < 100; ++i) {
+      mv.copyHistoryTo(block, blockSize);
+    }
+  };
+
+  timeSpan = perftimer::duration(bulkExport).count();
+
+  std::cout << "bulk export of 100 blocks of " << blockSize << " values took: " << timeSpan << " sec - "
+            << std::fixed << std::setprecision(4)
+            << static_cast<double>(100 * blockSize) / timeSpan
+            << " int64 copied per second\n\n";
+
+  //////////////////////////////////////////////////////////////////////////////
+
   std::cout << "--- Ended ---" << std::endl;
 }
 
 int main () {
+  coroutineFanInPerfTest();
+  registryPerfTest();
+  persisterPerfTest();
+  walPerfTest();
+  historyFilePerfTest();
+  exportPerfTest();
+  tieredPerfTest();
+  rollupPerfTest();
+  retentionPerfTest();
+  changeOnlyPerfTest();
+  samplingPerfTest();
+  rangeIndexPerfTest();
+  utf8PerfTest();
+  arrowPerfTest();
   perfTest();
   return 0;
 }
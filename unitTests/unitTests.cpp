@@ -3,9 +3,29 @@
 //
 #include "bigint.h"
 #include "../memvar.h"
+#include "../memvarConcurrent.h"
+#include "../memvarCoro.h"
+#include "../memvarShm.h"
+#include "../memvarRegistry.h"
+#include "../memframe.h"
+#include "../memvarLog.h"
+#include "../memvarFile.h"
+#include "../memvarExport.h"
+#include "../memvarArrow.h"
+#include "../memvarTiered.h"
+#include "../memvarRollup.h"
+#include "../memvarRangeIndex.h"
+#include <filesystem>
+#include <iomanip>
+#include <sys/wait.h>
 #include <iostream>
 #include <chrono>
 #include <memory>
+#include <vector>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <random>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
@@ -487,6 +507,317 @@ TEST(memVarTimedTest, timeTaggedTest_9)
   std::cout << "mvt2: "; mvt2.printHistoryTimedData();
 }
 
+TEST(memVarTimedTest, timeTaggedTest_10)
+{
+  using memvarType = int64_t;
+  memvar::memvarTimed<memvarType> mvt {0, 5};
+  const std::vector<memvarType> values {1, 2, 3};
+
+  ASSERT_EQ(3, mvt.append(values));
+  ASSERT_EQ(3, mvt);
+  ASSERT_EQ(4, mvt.getHistorySize());
+  ASSERT_EQ(0, mvt(3));
+  // all the values of a bulk append share the same time tag
+  ASSERT_EQ(mvt.getTimeTag(0), mvt.getTimeTag(2));
+  ASSERT_LE(mvt.getTimeTag(3), mvt.getTimeTag(0));
+
+  const std::vector<memvarType> more {4, 5, 6, 7, 8, 9, 10};
+  ASSERT_EQ(5, mvt.append(more.cbegin(), more.cend()));
+  ASSERT_EQ(5, mvt.getHistorySize());
+  for (memvar::memvarBase::capacityType i {0}; i < mvt.getHistorySize(); ++i)
+  {
+    auto [v, t, e] = mvt.getHistoryValue(i);
+    ASSERT_EQ(10 - i, v);
+    ASSERT_EQ(false, e);
+  }
+  mvt = 11;
+  ASSERT_EQ(11, mvt);
+  ASSERT_EQ(10, mvt(1));
+  ASSERT_EQ(5, mvt.getHistorySize());
+  mvt.printHistoryTimedData();
+}
+
+TEST(memVarTimedTest, timeTaggedTest_11)
+{
+  using memvarType = int64_t;
+  memvar::memvarTimed<memvarType> mvt {0, 100};
+
+  for (auto policy : {memvar::reclaimPolicy::immediate,
+                      memvar::reclaimPolicy::deferred,
+                      memvar::reclaimPolicy::background})
+  {
+    mvt.setReclaimPolicy(policy);
+    for (memvarType i {1}; i <= 200; ++i)
+    {
+      mvt = i;
+    }
+    mvt.clearHistory();
+    ASSERT_EQ(0, mvt);
+    ASSERT_EQ(1, mvt.getHistorySize());
+    ASSERT_EQ(std::chrono::nanoseconds {0}, mvt.getTimeTag());
+
+    mvt = 1;
+    mvt = 2;
+    ASSERT_EQ(2, mvt);
+    ASSERT_EQ(1, mvt(1));
+    ASSERT_EQ(0, mvt(2));
+    ASSERT_LE(mvt.getTimeTag(1), mvt.getTimeTag(0));
+    ASSERT_EQ(std::chrono::nanoseconds {0}, mvt.getTimeTag(2));
+  }
+  memvar::historyReclaimer::instance().waitIdle();
+  mvt.printHistoryTimedData();
+}
+
+TEST(memVarTimedTest, timeTaggedTest_12)
+{
+  using memvarType = int64_t;
+  memvar::memvarTimed<memvarType> mvt {0, 50};
+  for (memvarType i {1}; i < 50; ++i)
+  {
+    mvt = i;
+  }
+  const auto timeTag {mvt.getTimeTag(4)};
+
+  mvt.setHistoryCapacity(5);
+  ASSERT_EQ(5, mvt.getHistoryCapacity());
+  ASSERT_EQ(5, mvt.getHistorySize());
+  ASSERT_EQ(49, mvt);
+  ASSERT_EQ(45, mvt(4));
+  ASSERT_EQ(timeTag, mvt.getTimeTag(4));
+  EXPECT_THROW(mvt.getTimeTag(5), std::out_of_range);
+
+  mvt.setHistoryCapacity(8);
+  for (memvarType i {50}; i < 60; ++i)
+  {
+    mvt = i;
+  }
+  ASSERT_EQ(8, mvt.getHistorySize());
+  ASSERT_EQ(52, mvt(7));
+  ASSERT_LE(mvt.getTimeTag(7), mvt.getTimeTag(0));
+  EXPECT_THROW(mvt.getTimeTag(8), std::out_of_range);
+  memvar::historyReclaimer::instance().waitIdle();
+  mvt.printHistoryTimedData();
+}
+
+TEST(memVarTimedTest, timeTaggedTest_13)
+{
+  std::vector<memvar::memvarTimed<int>> mvts {};
+  for (int i {0}; i < 100; ++i)
+  {
+    mvts.emplace_back(i);
+  }
+  for (auto& mvt : mvts)
+  {
+    ++mvt;
+  }
+  ASSERT_EQ(1, mvts[0]);
+  ASSERT_EQ(100, mvts[99]);
+
+  const auto timeTag {mvts[99].getTimeTag()};
+  memvar::memvarTimed<int> mvt {std::move(mvts[99])};
+  ASSERT_EQ(100, mvt);
+  ASSERT_EQ(99, mvt(1));
+  ASSERT_EQ(timeTag, mvt.getTimeTag());
+
+  mvts[0] = std::move(mvt);
+  ASSERT_EQ(100, mvts[0]);
+  ASSERT_EQ(timeTag, mvts[0].getTimeTag());
+  mvts[0] = 101;
+  ASSERT_EQ(3, mvts[0].getHistorySize());
+  mvts[0].printHistoryTimedData();
+}
+
+TEST(memVarTimedTest, timeTaggedTest_14)
+{
+  using mvtType = memvar::memvarTimed<int>;
+  mvtType mvt {0, 3};
+  const auto now {std::chrono::high_resolution_clock::now()};
+
+  mvt.setValueAt(1, std::chrono::time_point_cast<std::chrono::nanoseconds>(now + std::chrono::seconds {1}));
+  mvt.setValueAt(2, std::chrono::time_point_cast<std::chrono::nanoseconds>(now + std::chrono::seconds {2}));
+  ASSERT_EQ(2, mvt);
+  ASSERT_EQ(std::chrono::seconds {1}, mvt.getTimeTag(0) - mvt.getTimeTag(1));
+
+  mvt.setValueAt(3, std::chrono::time_point_cast<std::chrono::nanoseconds>(now + std::chrono::seconds {3}));
+  ASSERT_EQ(3, mvt.getHistorySize());
+  EXPECT_THROW(mvt.getTimeTag(3), std::out_of_range);
+  ASSERT_EQ(std::chrono::seconds {2}, mvt.getTimeTag(0) - mvt.getTimeTag(2));
+}
+
+TEST(memVarTimedTest, timeTaggedTest_15)
+{
+  memvar::memvarTimed<int> mvt {0, 4};
+  std::vector<std::chrono::nanoseconds> timeTags {};
+  mvt.onChange([&mvt, &timeTags] (const int& value, memvar::memvarBase::sequenceType)
+               {
+                 // the time tag of the value is already stored
+                 ASSERT_EQ(value, mvt());
+                 timeTags.push_back(mvt.getTimeTag());
+               });
+  mvt = 1;
+  mvt = 2;
+  const std::vector<int> values {3, 4};
+  mvt.append(values);
+  ASSERT_EQ(4U, mvt.getSequence());
+  ASSERT_EQ(3U, timeTags.size());
+  ASSERT_EQ(timeTags[2], mvt.getTimeTag(1));
+  ASSERT_EQ(timeTags[1], mvt.getTimeTag(2));
+}
+
+TEST(memVarTimedTest, timeTaggedTest_16)
+{
+  using namespace std::chrono_literals;
+  using mvtType = memvar::memvarTimed<int>;
+  // at most 100 values, the ones of the last 30 seconds
+  mvtType mvt {0, 100};
+  ASSERT_EQ(0ns, mvt.getRetention());
+  ASSERT_THROW(mvt.setRetention(-1s), std::invalid_argument);
+  const mvtType::timePoint start {mvt.getTimePoint()};
+  mvt.setRetention(30s);
+
+  // a value a second
+  for (int i {1}; i <= 60; ++i)
+  {
+    mvt.setValueAt(i, start + i * 1s);
+  }
+  ASSERT_EQ(31, mvt.getHistorySize());
+  ASSERT_EQ(30, mvt(30));
+  ASSERT_EQ(30s, mvt.getTimePoint() - mvt.getTimePoint(30));
+
+  // a burst is capped by the history capacity
+  for (int i {0}; i < 1'000; ++i)
+  {
+    mvt.setValueAt(1'000 + i, start + 61s + i * 1ms);
+  }
+  ASSERT_EQ(100, mvt.getHistorySize());
+  ASSERT_EQ(1'999, mvt());
+
+  // the subscribers see the history already expired
+  const auto id {mvt.onChange([&mvt] (const int&, memvar::memvarBase::sequenceType)
+               {
+                 ASSERT_LE(mvt.getTimePoint() - mvt.getTimePoint(static_cast<size_t>(mvt.getHistorySize() - 1)), 30s);
+               })};
+  mvt.setValueAt(2'000, start + 100s);
+  ASSERT_EQ(1, mvt.getHistorySize());
+  const std::vector<int> values {1, 2, 3};
+  mvt.append(values);
+  ASSERT_EQ(4, mvt.getHistorySize());
+
+  // a history that is no longer written expires on demand, but for the
+  // current value
+  mvt.expireHistory(start + 200s);
+  ASSERT_EQ(1, mvt.getHistorySize());
+  ASSERT_EQ(3, mvt());
+  ASSERT_TRUE(mvt.unsubscribe(id));
+  // a shorter retention applies at once
+  mvt.setRetention(0ns);
+  mvt.setValueAt(4, start + 200s);
+  mvt.setValueAt(5, start + 300s);
+  ASSERT_EQ(3, mvt.getHistorySize());
+  mvt.setRetention(150s);
+  ASSERT_EQ(2, mvt.getHistorySize());
+}
+
+TEST(memVarTimedTest, timeTaggedTest_17)
+{
+  using namespace std::chrono_literals;
+  using mvtType = memvar::memvarTimed<double>;
+  mvtType mvt {1.0, 10};
+  mvt.setChangeOnly(true);
+  mvt.setChangeEpsilon(0.01);
+  const mvtType::timePoint start {mvt.getTimePoint()};
+  ASSERT_EQ(start, mvt.getLastConfirmed());
+
+  mvt.setValueAt(1.005, start + 1s);
+  mvt.setValueAt(1.0, start + 2s);
+  // the current value was confirmed, not written again
+  ASSERT_EQ(1, mvt.getHistorySize());
+  ASSERT_EQ(start, mvt.getTimePoint());
+  ASSERT_EQ(start + 2s, mvt.getLastConfirmed());
+  ASSERT_EQ(2U, mvt.getUnchangedCount());
+
+  mvt.setValueAt(1.5, start + 3s);
+  ASSERT_EQ(2, mvt.getHistorySize());
+  ASSERT_EQ(start + 3s, mvt.getLastConfirmed());
+  mvt.clearHistory();
+  ASSERT_EQ(mvt.getTimePoint(), mvt.getLastConfirmed());
+}
+
+TEST(memVarTimedTest, timeTaggedTest_18)
+{
+  using namespace std::chrono_literals;
+  using mvtType = memvar::memvarTimed<int>;
+  mvtType mvt {0, 100};
+  ASSERT_THROW(mvt.setSampling(0ns), std::invalid_argument);
+  ASSERT_THROW(mvt.setSampling(memvar::sampling::timeQuantum), std::invalid_argument);
+  mvt.setSampling(1s);
+  ASSERT_EQ(memvar::sampling::timeQuantum, mvt.getSampling());
+
+  // 10 writes a second for 10 seconds
+  const mvtType::timePoint start {std::chrono::hours {1}};
+  for (int i {0}; i < 100; ++i)
+  {
+    mvt.setValueAt(i, start + i * 100ms);
+  }
+  // the current value, and the first write of each second
+  ASSERT_EQ(12, mvt.getHistorySize());
+  ASSERT_EQ(99, mvt());
+  ASSERT_EQ(start + 9'900ms, mvt.getTimePoint());
+  for (int i {1}; i < 11; ++i)
+  {
+    ASSERT_EQ((10 - i) * 10, mvt(i));
+    ASSERT_EQ(start + (10 - i) * 1s, mvt.getTimePoint(static_cast<size_t>(i)));
+  }
+  ASSERT_EQ(mvt.getTimeHistory().size(), static_cast<size_t>(mvt.getHistorySize()));
+
+  // a reservoir keeps the time points with their values
+  mvtType mvtr {0, 10};
+  mvtr.setSampling(memvar::sampling::reservoir);
+  for (int i {1}; i <= 10'000; ++i)
+  {
+    mvtr.setValueAt(i, start + i * 1ms);
+  }
+  ASSERT_EQ(10'000, mvtr());
+  ASSERT_GT(mvtr.getHistorySize(), 5);
+  ASSERT_EQ(static_cast<size_t>(mvtr.getHistorySize()), mvtr.getTimeHistory().size());
+  // the oldest value is the initial one
+  for (memvar::memvarBase::capacityType i {1}; i < mvtr.getHistorySize() - 1; ++i)
+  {
+    ASSERT_EQ(start + mvtr(i) * 1ms, mvtr.getTimePoint(static_cast<size_t>(i)));
+    ASSERT_LT(mvtr(i), mvtr(i - 1));
+  }
+}
+
+TEST(memVarTimedTest, timeTaggedTest_19)
+{
+  using namespace std::chrono_literals;
+  // clearing a history past its retention
+  memvar::memvarTimed<int> mvt {0, 10};
+  mvt.setRetention(5ms);
+  for (int i {1}; i <= 5; ++i)
+  {
+    mvt = i;
+  }
+  std::this_thread::sleep_for(20ms);
+  std::vector<memvar::memvarBase::capacityType> sizes {};
+  mvt.onChange([&mvt, &sizes] (const int&, memvar::memvarBase::sequenceType)
+               {
+                 sizes.push_back(mvt.getHistorySize());
+                 ASSERT_EQ(static_cast<size_t>(mvt.getHistorySize()), mvt.getTimeHistory().size());
+               });
+  mvt.clearHistory();
+  ASSERT_EQ(1, mvt.getHistorySize());
+  ASSERT_EQ(1U, mvt.getTimeHistory().size());
+  ASSERT_EQ(0, mvt());
+  ASSERT_EQ(0ns, mvt.getTimeTag());
+  // the 'zero' value is not a write
+  ASSERT_TRUE(sizes.empty());
+  mvt = 6;
+  ASSERT_EQ(2, mvt.getHistorySize());
+  ASSERT_EQ(2U, mvt.getTimeHistory().size());
+  ASSERT_EQ(std::vector<memvar::memvarBase::capacityType> {2}, sizes);
+}
+
 // Yet another way to compute the Fibonacci numbers
 TEST(memVarTimedTest, fibonacciNumbers)
 {
@@ -1058,4 +1389,2066 @@ TEST(memVarTest, test_12)
   ASSERT_EQ(10, (*mv_uptr)(1));
   ASSERT_EQ(22, (*mv_shptr)(1));
 }
+TEST(memVarTest, test_13)
+{
+  using memvarType = int64_t;
+  memvar::memvar<memvarType> mv {0, 10};
+
+  // nothing to append
+  ASSERT_EQ(0, mv.append(std::span<const memvarType> {}));
+  ASSERT_EQ(1, mv.getHistorySize());
+
+  const std::vector<memvarType> values {1, 2, 3, 4};
+  ASSERT_EQ(4, mv.append(values));
+  ASSERT_EQ(4, mv);
+  ASSERT_EQ(3, mv(1));
+  ASSERT_EQ(0, mv(4));
+  ASSERT_EQ(5, mv.getHistorySize());
+
+  // only the newest values that fit the history capacity are written
+  std::vector<memvarType> many (100);
+  std::iota(many.begin(), many.end(), 100);
+  ASSERT_EQ(10, mv.append(many.cbegin(), many.cend()));
+  ASSERT_EQ(10, mv.getHistorySize());
+  ASSERT_EQ(199, mv);
+  ASSERT_EQ(190, mv(9));
+
+  // the old values pushed out by the appended ones are evicted
+  ASSERT_EQ(3, mv.append(values.cbegin(), values.cbegin() + 3));
+  ASSERT_EQ(10, mv.getHistorySize());
+  ASSERT_EQ(3, mv);
+  ASSERT_EQ(1, mv(2));
+  ASSERT_EQ(199, mv(3));
+  ASSERT_EQ(193, mv(9));
+
+  auto [min, max] = mv.getHistoryMinMax();
+  ASSERT_EQ(1, min);
+  ASSERT_EQ(199, max);
+
+  memvar::memvar<std::string> mvs {"A", 3};
+  const std::vector<std::string> strings {"B", "C", "D"};
+  ASSERT_EQ(3, mvs.append(strings));
+  ASSERT_EQ("D", mvs());
+  ASSERT_EQ("B", mvs(2));
+  mvs.printHistoryData();
+}
+
+TEST(memVarTest, test_14)
+{
+  using memvarType = int64_t;
+  memvar::memvar<memvarType> mv {0, 1'000};
+  for (memvarType i {1}; i < 1'000; ++i)
+  {
+    mv = i;
+  }
+
+  std::vector<memvarType> out (2'000);
+  ASSERT_EQ(1'000, mv.copyHistoryTo(out, 2'000));
+  for (memvarType i {0}; i < 1'000; ++i)
+  {
+    ASSERT_EQ(999 - i, out[static_cast<size_t>(i)]);
+  }
+
+  ASSERT_EQ(10, mv.copyHistoryTo(out, 10, memvar::historyOrder::oldestFirst));
+  for (memvarType i {0}; i < 10; ++i)
+  {
+    ASSERT_EQ(990 + i, out[static_cast<size_t>(i)]);
+  }
+
+  // the copy is capped by the size of the output
+  std::vector<memvarType> small (4);
+  ASSERT_EQ(4, mv.copyHistoryTo(small, 100));
+  ASSERT_EQ(999, small[0]);
+  ASSERT_EQ(996, small[3]);
+  ASSERT_EQ(0, mv.copyHistoryTo(small, 0));
+  ASSERT_EQ(0, mv.copyHistoryTo(small, -1));
+
+  memvar::memvar<std::string> mvs {"A"};
+  mvs = "B";
+  std::vector<std::string> strings (2);
+  ASSERT_EQ(2, mvs.copyHistoryTo(strings, 2, memvar::historyOrder::oldestFirst));
+  ASSERT_EQ("A", strings[0]);
+  ASSERT_EQ("B", strings[1]);
+}
+TEST(memVarTest, test_15)
+{
+  using memvarType = int64_t;
+  constexpr memvar::memvar<memvarType>::capacityType historyCapacity {1'000};
+  memvar::memvar<memvarType> mv {0, historyCapacity};
+  ASSERT_EQ(memvar::reclaimPolicy::deferred, mv.getReclaimPolicy());
+
+  auto fill = [&mv] ()
+  {
+    memvarType c {0};
+    while ( !mv.isHistoryFull() )
+    {
+      mv = ++c;
+    }
+  };
+
+  for (auto policy : {memvar::reclaimPolicy::immediate,
+                      memvar::reclaimPolicy::deferred,
+                      memvar::reclaimPolicy::background})
+  {
+    mv.setReclaimPolicy(policy);
+    ASSERT_EQ(policy, mv.getReclaimPolicy());
+    fill();
+    ASSERT_EQ(historyCapacity, mv.getHistorySize());
+
+    mv.clearHistory();
+    ASSERT_EQ(0, mv);
+    ASSERT_EQ(1, mv.getHistorySize());
+    ASSERT_EQ(historyCapacity, mv.getHistoryCapacity());
+    auto [v, e] = mv.getHistoryValue(1);
+    ASSERT_EQ(0, v);
+    ASSERT_EQ(true, e);
+
+    if ( memvar::reclaimPolicy::deferred == policy )
+    {
+      // the cleared history is released by the writes that follow,
+      // starting from the one storing the 'zero' value
+      constexpr auto stride {memvar::retiredHistory<std::deque<memvarType>>::releaseStride_};
+      ASSERT_EQ(static_cast<size_t>(historyCapacity) - stride, mv.getRetiredHistorySize());
+      mv = 1;
+      ASSERT_EQ(static_cast<size_t>(historyCapacity) - 2 * stride, mv.getRetiredHistorySize());
+      fill();
+    }
+    ASSERT_EQ(0U, mv.getRetiredHistorySize());
+  }
+  memvar::historyReclaimer::instance().waitIdle();
+
+  // clearing twice in a row in deferred mode: the first retired history is
+  // handed over to the background reclaimer
+  mv.setReclaimPolicy(memvar::reclaimPolicy::deferred);
+  fill();
+  mv.clearHistory();
+  mv = 1;
+  ASSERT_LT(0U, mv.getRetiredHistorySize());
+  mv.clearHistory();
+  ASSERT_EQ(0, mv);
+  ASSERT_EQ(1, mv.getHistorySize());
+  ASSERT_EQ(0U, mv.getRetiredHistorySize());
+  memvar::historyReclaimer::instance().waitIdle();
+}
+TEST(memVarTest, test_16)
+{
+  using memvarType = int64_t;
+  memvar::memvar<memvarType> mv {0, 10};
+  for (memvarType i {1}; i < 10; ++i)
+  {
+    mv = i;
+  }
+  ASSERT_TRUE(mv.isHistoryFull());
+
+  EXPECT_THROW(mv.setHistoryCapacity(1), std::invalid_argument);
+  EXPECT_THROW(mv.setHistoryCapacity(-10), std::invalid_argument);
+  ASSERT_EQ(10, mv.getHistoryCapacity());
+
+  // growing keeps the history
+  mv.setHistoryCapacity(20);
+  ASSERT_EQ(20, mv.getHistoryCapacity());
+  ASSERT_EQ(10, mv.getHistorySize());
+  ASSERT_FALSE(mv.isHistoryFull());
+  for (memvarType i {10}; i < 30; ++i)
+  {
+    mv = i;
+  }
+  ASSERT_EQ(20, mv.getHistorySize());
+  ASSERT_EQ(29, mv);
+  ASSERT_EQ(10, mv(19));
+
+  // shrinking evicts the oldest values, few of them
+  mv.setHistoryCapacity(15);
+  ASSERT_EQ(15, mv.getHistorySize());
+  ASSERT_EQ(29, mv);
+  ASSERT_EQ(15, mv(14));
+  ASSERT_TRUE(mv.isHistoryFull());
+
+  // shrinking evicts the oldest values, most of them
+  for (auto policy : {memvar::reclaimPolicy::immediate,
+                      memvar::reclaimPolicy::deferred,
+                      memvar::reclaimPolicy::background})
+  {
+    mv.setReclaimPolicy(policy);
+    mv.setHistoryCapacity(100);
+    for (memvarType i {1}; i <= 100; ++i)
+    {
+      mv = i;
+    }
+    mv.setHistoryCapacity(3);
+    ASSERT_EQ(3, mv.getHistorySize());
+    ASSERT_EQ(100, mv);
+    ASSERT_EQ(99, mv(1));
+    ASSERT_EQ(98, mv(2));
+    auto [min, max] = mv.getHistoryMinMax();
+    ASSERT_EQ(98, min);
+    ASSERT_EQ(100, max);
+
+    mv = 101;
+    ASSERT_EQ(3, mv.getHistorySize());
+    ASSERT_EQ(99, mv(2));
+  }
+  memvar::historyReclaimer::instance().waitIdle();
+  mv.printHistoryData();
+}
+TEST(memVarTest, test_17)
+{
+  static_assert(std::is_move_constructible_v<memvar::memvar<double>>);
+  static_assert(std::is_move_assignable_v<memvar::memvar<double>>);
+  static_assert(!std::is_copy_constructible_v<memvar::memvar<double>>);
+
+  std::vector<memvar::memvar<double>> mvs {};
+  for (int i {0}; i < 1'000; ++i)
+  {
+    mvs.emplace_back(static_cast<double>(i), 4);
+  }
+  for (auto& mv : mvs)
+  {
+    mv += 0.5;
+  }
+  ASSERT_EQ(1'000U, mvs.size());
+  ASSERT_EQ(0.5, mvs[0]);
+  ASSERT_EQ(0.0, mvs[0](1));
+  ASSERT_EQ(999.5, mvs[999]);
+  ASSERT_EQ(999.0, mvs[999](1));
+  ASSERT_EQ(4, mvs[999].getHistoryCapacity());
+
+  // moving steals the history
+  mvs.erase(mvs.begin());
+  ASSERT_EQ(1.5, mvs[0]);
+  ASSERT_EQ(1.0, mvs[0](1));
+  ASSERT_EQ(2, mvs[0].getHistorySize());
+
+  memvar::memvar<double> mv {std::move(mvs.back())};
+  ASSERT_EQ(999.5, mv);
+  ASSERT_EQ(999.0, mv(1));
+  ASSERT_EQ(0, mvs.back().getHistorySize());
+
+  mvs.back() = std::move(mvs.front());
+  ASSERT_EQ(1.5, mvs.back());
+  ASSERT_EQ(2, mvs.back().getHistorySize());
+
+  // copy assignment still stores the value of the other memvar
+  mv = mvs.back();
+  ASSERT_EQ(1.5, mv);
+  ASSERT_EQ(999.5, mv(1));
+  ASSERT_EQ(3, mv.getHistorySize());
+
+  // the subscriptions stay with the memvar they were made on
+  int calls {0};
+  int movedCalls {0};
+  const auto id {mv.onChange([&calls] (const double&, memvar::memvarBase::sequenceType) { ++calls; })};
+  mvs.back().onChange([&movedCalls] (const double&, memvar::memvarBase::sequenceType) { ++movedCalls; });
+  memvar::memvar<double> moved {std::move(mv)};
+  moved = 2.5;
+  ASSERT_EQ(0, calls);
+  mvs.back() = std::move(moved);
+  mvs.back() = 3.5;
+  ASSERT_EQ(0, calls);
+  ASSERT_EQ(1, movedCalls);
+  ASSERT_TRUE(mv.unsubscribe(id));
+}
+TEST(memVarConcurrentTest, test_0)
+{
+  EXPECT_THROW(memvar::memvarConcurrent<int> mvci(0, 1), std::invalid_argument);
+  EXPECT_NO_THROW(memvar::memvarConcurrent<int> mvci {});
+
+  memvar::memvarConcurrent<int64_t> mvc {0, 5};
+  ASSERT_EQ(5, mvc.getHistoryCapacity());
+  ASSERT_EQ(1, mvc.getHistorySize());
+  ASSERT_EQ(0, mvc);
+
+  for (int64_t i {1}; i <= 3; ++i)
+  {
+    mvc = i;
+  }
+  ASSERT_EQ(3, mvc());
+  ASSERT_EQ(2, mvc(1));
+  ASSERT_EQ(0, mvc(3));
+  ASSERT_EQ(4, mvc.getHistorySize());
+  ASSERT_FALSE(mvc.isHistoryFull());
+
+  for (int64_t i {4}; i <= 100; ++i)
+  {
+    mvc = i;
+  }
+  ASSERT_TRUE(mvc.isHistoryFull());
+  ASSERT_EQ(5, mvc.getHistorySize());
+  ASSERT_EQ(101U, mvc.getWriteCount());
+  ASSERT_EQ(100, mvc);
+  ASSERT_EQ(96, getHistoryValue(mvc, 4));
+
+  // trying to access the history out of bound
+  auto [v, e] = mvc.getHistoryValue(5);
+  ASSERT_EQ(0, v);
+  ASSERT_EQ(true, e);
+  std::tie(v, e) = mvc.getHistoryValue(-1);
+  ASSERT_EQ(true, e);
+  std::cout << mvc << '\n';
+}
+
+TEST(memVarConcurrentTest, test_1)
+{
+  // the fields are all equal when a value is not torn
+  struct quad
+  {
+    uint64_t a, b, c, d;
+  };
+  constexpr uint64_t writes {200'000};
+  memvar::memvarConcurrent<quad> mvc {quad {0, 0, 0, 0}, 16};
+  std::atomic<bool> done {false};
+
+  auto reader = [&mvc, &done] ()
+  {
+    uint64_t last {0};
+    uint64_t reads {0};
+    while ( !done.load() || (reads == 0) )
+    {
+      const quad current {mvc()};
+      EXPECT_TRUE(current.a == current.b && current.b == current.c && current.c == current.d);
+      // the writer writes increasing values
+      EXPECT_LE(last, current.a);
+      last = current.a;
+
+      auto [older, error] = mvc.getHistoryValue(8);
+      if ( !error )
+      {
+        EXPECT_TRUE(older.a == older.b && older.b == older.c && older.c == older.d);
+      }
+      ++reads;
+    }
+  };
+
+  std::vector<std::jthread> readers {};
+  for (int i {0}; i < 3; ++i)
+  {
+    readers.emplace_back(reader);
+  }
+  for (uint64_t i {1}; i <= writes; ++i)
+  {
+    mvc = quad {i, i, i, i};
+  }
+  done = true;
+  readers.clear();
+
+  ASSERT_EQ(writes, mvc().a);
+  for (memvar::memvarBase::capacityType i {0}; i < mvc.getHistorySize(); ++i)
+  {
+    ASSERT_EQ(writes - static_cast<uint64_t>(i), mvc(i).d);
+  }
+}
+TEST(memVarConcurrentTest, test_2)
+{
+  memvar::memvarConcurrent<int64_t> mvc {0, 8};
+  ASSERT_EQ(0U, mvc.getSequence());
+
+  std::atomic<memvar::memvarBase::sequenceType> ready {0};
+  std::jthread consumer ([&mvc, &ready] ()
+                         {
+                           memvar::memvarBase::sequenceType seen {0};
+                           while ( seen < 100 )
+                           {
+                             const auto sequence {mvc.waitForChange(seen)};
+                             EXPECT_LT(seen, sequence);
+                             // the values are the sequence numbers, some may have been missed
+                             EXPECT_LE(static_cast<int64_t>(seen + 1), mvc());
+                             seen = sequence;
+                           }
+                           ready = seen;
+                         });
+  for (int64_t i {1}; i <= 100; ++i)
+  {
+    mvc = i;
+  }
+  consumer.join();
+  ASSERT_EQ(100U, ready.load());
+  ASSERT_EQ(100U, mvc.getSequence());
+  // nothing to wait for
+  ASSERT_EQ(100U, mvc.waitForChange(99));
+
+  memvar::memvarSegmented<int64_t> mvs {0, 8};
+  std::jthread writer ([&mvs] ()
+                       {
+                         std::this_thread::sleep_for(std::chrono::milliseconds {10});
+                         mvs = 1;
+                       });
+  ASSERT_EQ(1U, mvs.waitForChange(0));
+  ASSERT_EQ(1, mvs.snapshot()());
+}
+
+TEST(memVarConcurrentTest, test_3)
+{
+  memvar::memvarConcurrent<int64_t> mvc {0, 5};
+  ASSERT_EQ(7, mvc.getMaxHistoryCapacity());
+  EXPECT_THROW(mvc.setHistoryCapacity(1), std::invalid_argument);
+  EXPECT_THROW(mvc.setHistoryCapacity(8), std::invalid_argument);
+  for (int64_t i {1}; i <= 10; ++i)
+  {
+    mvc = i;
+  }
+
+  // the values dropped by a shrink do not come back when the capacity grows
+  mvc.setHistoryCapacity(3);
+  ASSERT_EQ(3, mvc.getHistoryCapacity());
+  ASSERT_EQ(3, mvc.getHistorySize());
+  ASSERT_TRUE(mvc.isHistoryFull());
+  ASSERT_EQ(8, mvc(2));
+  ASSERT_TRUE(std::get<bool>(mvc.getHistoryValue(3)));
+  mvc.setHistoryCapacity(7);
+  ASSERT_EQ(3, mvc.getHistorySize());
+  ASSERT_TRUE(std::get<bool>(mvc.getHistoryValue(3)));
+  for (int64_t i {11}; i <= 20; ++i)
+  {
+    mvc = i;
+  }
+  ASSERT_EQ(7, mvc.getHistorySize());
+  ASSERT_EQ(14, mvc(6));
+}
+
+TEST(memVarMultiProducerTest, test_0)
+{
+  using memvarType = int64_t;
+  constexpr int producers {4};
+  constexpr memvarType writes {50'000};
+  // small staging rings: the producers also merge when their ring is full
+  memvar::memvarMultiProducer<memvarType> mvmp {-1, producers * writes + 1, 256};
+
+  std::vector<std::jthread> threads {};
+  for (int p {0}; p < producers; ++p)
+  {
+    auto& producer {mvmp.makeProducer()};
+    threads.emplace_back([&producer, p] ()
+                         {
+                           for (memvarType i {0}; i < writes; ++i)
+                           {
+                             producer = p * writes + i;
+                           }
+                         });
+  }
+  threads.clear();
+
+  ASSERT_EQ(producers * writes + 1, mvmp.getHistorySize());
+  ASSERT_EQ(-1, mvmp(producers * writes));
+
+  mvmp.withHistory([] (const auto& history)
+                   {
+                     std::vector<memvarType> last (producers, -1);
+                     // from the oldest value to the newest one
+                     for (auto i {history.getHistorySize() - 2}; i >= 0; --i)
+                     {
+                       auto [v, t, e] = history.getHistoryValue(i);
+                       ASSERT_FALSE(e);
+                       // the values of each producer keep their order
+                       const auto p {static_cast<size_t>(v / writes)};
+                       ASSERT_LT(last[p], v);
+                       last[p] = v;
+                     }
+                     for (int p {0}; p < producers; ++p)
+                     {
+                       ASSERT_EQ((p + 1) * writes - 1, last[static_cast<size_t>(p)]);
+                     }
+                   });
+  // nothing left to merge
+  ASSERT_EQ(0U, mvmp.merge());
+}
+
+TEST(memVarMultiProducerTest, test_1)
+{
+  memvar::memvarMultiProducer<int> mvmp {0, 100};
+  auto& p1 {mvmp.makeProducer()};
+  auto& p2 {mvmp.makeProducer()};
+
+  // each merge orders the staged values by time point
+  p2 = 1;
+  p1 = 2;
+  p2 = 3;
+  ASSERT_EQ(3U, mvmp.merge());
+  ASSERT_EQ(3, mvmp());
+  ASSERT_EQ(2, mvmp(1));
+  ASSERT_EQ(1, mvmp(2));
+  mvmp.withHistory([] (const auto& history)
+                   {
+                     ASSERT_LE(history.getTimeTag(1), history.getTimeTag(0));
+                     ASSERT_LE(history.getTimeTag(2), history.getTimeTag(1));
+                   });
+
+  // the combiner merges with no reads
+  mvmp.startCombiner(std::chrono::microseconds {100});
+  p1 = 4;
+  std::this_thread::sleep_for(std::chrono::milliseconds {100});
+  mvmp.stopCombiner();
+  ASSERT_EQ(0U, mvmp.merge());
+  ASSERT_EQ(4, mvmp());
+  ASSERT_EQ(5, mvmp.getHistorySize());
+}
+
+// a clock set by the test; the next reader of the clock can be held after
+// it has read the time, as if preempted before staging its value
+struct manualClock {
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<manualClock>;
+  static constexpr bool is_steady {false};
+
+  static inline std::atomic<rep> now_ {0};
+  static inline std::atomic<bool> holdNext_ {false};
+  static inline std::atomic<bool> held_ {false};
+  static inline std::atomic<bool> released_ {false};
+
+  static time_point now() noexcept {
+    const auto t {now_.load()};
+    if ( holdNext_.exchange(false) )
+    {
+      held_ = true;
+      held_.notify_all();
+      released_.wait(false);
+    }
+    return time_point(duration(t));
+  }
+};
+
+TEST(memVarMultiProducerTest, test_2)
+{
+  manualClock::now_ = 1;
+  memvar::memvarMultiProducer<int, std::chrono::nanoseconds, manualClock> mvmp {0, 100};
+  auto& p1 {mvmp.makeProducer()};
+  auto& p2 {mvmp.makeProducer()};
+
+  // p1 reads the clock at 10 and is held before its value is staged, while
+  // p2 stages a value at 20 and a merge starts
+  manualClock::now_ = 10;
+  manualClock::holdNext_ = true;
+  std::jthread producer1 ([&p1] () { p1 = 1; });
+  manualClock::held_.wait(false);
+  manualClock::now_ = 20;
+  p2 = 2;
+  std::jthread merger ([&mvmp] () { mvmp.merge(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds {20});
+  manualClock::released_ = true;
+  manualClock::released_.notify_all();
+  producer1.join();
+  merger.join();
+
+  // the older value is not stored after the newer one
+  ASSERT_EQ(2, mvmp());
+  ASSERT_EQ(1, mvmp(1));
+  mvmp.withHistory([] (const auto& history)
+                   {
+                     ASSERT_EQ(std::chrono::nanoseconds {19}, history.getTimeTag(0));
+                     ASSERT_EQ(std::chrono::nanoseconds {9}, history.getTimeTag(1));
+                   });
+
+  // a value newer than the watermark of a merge waits for the next merge
+  manualClock::now_ = 50;
+  p1 = 3;
+  manualClock::now_ = 40;
+  ASSERT_EQ(0U, mvmp.merge());
+  manualClock::now_ = 60;
+  ASSERT_EQ(1U, mvmp.merge());
+  ASSERT_EQ(3, mvmp());
+}
+TEST(memVarMultiProducerTest, test_3)
+{
+  memvar::memvarMultiProducer<int> mvmp {0, 5};
+  auto& producer {mvmp.makeProducer()};
+  for (int i {1}; i <= 10; ++i)
+  {
+    producer = i;
+  }
+  EXPECT_THROW(mvmp.setHistoryCapacity(1), std::invalid_argument);
+  // the staged values are merged before the history is cut down
+  mvmp.setHistoryCapacity(3);
+  ASSERT_EQ(3, mvmp.getHistoryCapacity());
+  ASSERT_EQ(3, mvmp.getHistorySize());
+  ASSERT_EQ(8, mvmp(2));
+  mvmp.setHistoryCapacity(10);
+  for (int i {11}; i <= 20; ++i)
+  {
+    producer = i;
+  }
+  ASSERT_EQ(10, mvmp.getHistorySize());
+  ASSERT_EQ(11, mvmp(9));
+}
+TEST(memVarSegmentedTest, test_0)
+{
+  EXPECT_THROW(memvar::memvarSegmented<int> mvsi(0, 1), std::invalid_argument);
+
+  using memvarType = int64_t;
+  memvar::memvarSegmented<memvarType> mvs {0, 10, 4};
+  for (memvarType i {1}; i < 8; ++i)
+  {
+    mvs = i;
+  }
+  ASSERT_EQ(7, mvs);
+  ASSERT_EQ(8, mvs.getHistorySize());
+  ASSERT_EQ(0, mvs(7));
+
+  auto snapshot {mvs.snapshot()};
+  for (memvarType i {8}; i < 1'000; ++i)
+  {
+    mvs = i;
+  }
+  ASSERT_EQ(999, mvs);
+  ASSERT_EQ(990, mvs(9));
+  ASSERT_EQ(10, mvs.getHistorySize());
+  auto [v, e] = mvs.getHistoryValue(10);
+  ASSERT_EQ(true, e);
+
+  // the snapshot still sees the history as it was when it was taken
+  ASSERT_EQ(8, snapshot.getHistorySize());
+  ASSERT_EQ(8U, snapshot.getWriteCount());
+  ASSERT_EQ(7, snapshot());
+  ASSERT_EQ(0, snapshot(7));
+  std::tie(v, e) = snapshot.getHistoryValue(8);
+  ASSERT_EQ(true, e);
+  memvarType expected {0};
+  snapshot.forEach([&expected] (const memvarType& value) { ASSERT_EQ(expected++, value); });
+  ASSERT_EQ(8, expected);
+  auto [min, max] = snapshot.getHistoryMinMax();
+  ASSERT_EQ(0, min);
+  ASSERT_EQ(7, max);
+
+  snapshot = mvs.snapshot();
+  ASSERT_EQ(10, snapshot.getHistorySize());
+  expected = 990;
+  snapshot.forEachSpan([&expected] (std::span<const memvarType> values)
+                       {
+                         ASSERT_LE(values.size(), 4U);
+                         for (auto value : values)
+                         {
+                           ASSERT_EQ(expected++, value);
+                         }
+                       });
+  ASSERT_EQ(1'000, expected);
+
+  memvar::memvarSegmented<std::string> mvss {"A", 3};
+  mvss = "B";
+  auto stringSnapshot {mvss.snapshot()};
+  mvss = "C";
+  mvss = "D";
+  ASSERT_EQ("B", stringSnapshot());
+  ASSERT_EQ("A", stringSnapshot(1));
+  ASSERT_EQ("B", mvss(2));
+}
+
+TEST(memVarSegmentedTest, test_1)
+{
+  using memvarType = uint64_t;
+  constexpr memvarType writes {300'000};
+  memvar::memvarSegmented<memvarType> mvs {0, 1'000, 64};
+  std::atomic<bool> done {false};
+
+  auto reader = [&mvs, &done] ()
+  {
+    uint64_t snapshots {0};
+    while ( !done.load() || (snapshots == 0) )
+    {
+      const auto snapshot {mvs.snapshot()};
+      // the values are the write numbers: a consistent history is made of
+      // consecutive values ending with the last write seen
+      memvarType expected {snapshot.getWriteCount() - static_cast<memvarType>(snapshot.getHistorySize())};
+      snapshot.forEach([&expected] (const memvarType& value) { EXPECT_EQ(expected++, value); });
+      EXPECT_EQ(snapshot.getWriteCount(), expected);
+      EXPECT_EQ(snapshot.getWriteCount() - 1, snapshot());
+      ++snapshots;
+    }
+  };
+
+  std::vector<std::jthread> readers {};
+  for (int i {0}; i < 2; ++i)
+  {
+    readers.emplace_back(reader);
+  }
+  for (memvarType i {1}; i < writes; ++i)
+  {
+    mvs = i;
+  }
+  done = true;
+  readers.clear();
+  ASSERT_EQ(writes - 1, mvs);
+  ASSERT_EQ(1'000, mvs.getHistorySize());
+}
+TEST(memVarSegmentedTest, test_2)
+{
+  // the segment size is cut down to the history capacity
+  memvar::memvarSegmented<int> large {0, 10, 100};
+  ASSERT_EQ(10U, large.getSegmentSize());
+  memvar::memvarSegmented<int> empty {0, 10, 0};
+  ASSERT_EQ(1U, empty.getSegmentSize());
+
+  // a snapshot pinning a long chain of segments frees it without a deep
+  // recursion
+  memvar::memvarSegmented<int> mvs {0, 2, 1};
+  auto snapshot {std::make_unique<memvar::memvarSegmented<int>::historySnapshot>(mvs.snapshot())};
+  for (int i {1}; i <= 1'000'000; ++i)
+  {
+    mvs = i;
+  }
+  ASSERT_EQ(0, (*snapshot)());
+  snapshot.reset();
+  ASSERT_EQ(1'000'000, mvs);
+}
+TEST(memVarSegmentedTest, test_3)
+{
+  memvar::memvarSegmented<int64_t> mvs {0, 8, 4};
+  EXPECT_THROW(mvs.setHistoryCapacity(1), std::invalid_argument);
+  for (int64_t i {1}; i <= 20; ++i)
+  {
+    mvs = i;
+  }
+  auto snapshot {mvs.snapshot()};
+
+  // the values dropped by a shrink do not come back when the capacity grows
+  mvs.setHistoryCapacity(2);
+  ASSERT_EQ(2, mvs.getHistoryCapacity());
+  ASSERT_EQ(2, mvs.getHistorySize());
+  ASSERT_EQ(19, mvs(1));
+  ASSERT_TRUE(std::get<bool>(mvs.getHistoryValue(2)));
+  mvs.setHistoryCapacity(100);
+  ASSERT_EQ(2, mvs.getHistorySize());
+  ASSERT_EQ(4U, mvs.getSegmentSize());
+  for (int64_t i {21}; i <= 200; ++i)
+  {
+    mvs = i;
+  }
+  ASSERT_EQ(100, mvs.getHistorySize());
+  int64_t expected {101};
+  mvs.snapshot().forEach([&expected] (const int64_t& value) { ASSERT_EQ(expected++, value); });
+  ASSERT_EQ(201, expected);
+
+  // the snapshot taken before still sees its history
+  ASSERT_EQ(8, snapshot.getHistorySize());
+  ASSERT_EQ(13, snapshot(7));
+}
+TEST(memVarTest, test_18)
+{
+  using memvarType = int64_t;
+  memvar::memvar<memvarType> mv {0, 5};
+  ASSERT_EQ(0U, mv.getSequence());
+
+  std::vector<std::pair<memvarType, memvar::memvarBase::sequenceType>> seen {};
+  const auto id {mv.onChange([&seen] (const memvarType& value, const memvar::memvarBase::sequenceType sequence)
+                             {
+                               seen.emplace_back(value, sequence);
+                             })};
+  memvarType sum {0};
+  const auto id2 {mv.onChange([&sum] (const memvarType& value, memvar::memvarBase::sequenceType)
+                              {
+                                sum += value;
+                              })};
+  ASSERT_NE(id, id2);
+
+  mv = 10;
+  ++mv;
+  mv += 4;
+  ASSERT_EQ(3U, mv.getSequence());
+  ASSERT_EQ(3U, seen.size());
+  ASSERT_EQ(10, seen[0].first);
+  ASSERT_EQ(1U, seen[0].second);
+  ASSERT_EQ(15, seen[2].first);
+  ASSERT_EQ(3U, seen[2].second);
+  ASSERT_EQ(36, sum);
+
+  // a bulk append counts all its values but calls the subscribers once
+  const std::vector<memvarType> values {1, 2, 3, 4, 5, 6, 7};
+  mv.append(values);
+  ASSERT_EQ(10U, mv.getSequence());
+  ASSERT_EQ(4U, seen.size());
+  ASSERT_EQ(7, seen[3].first);
+  ASSERT_EQ(10U, seen[3].second);
+
+  ASSERT_TRUE(mv.unsubscribe(id));
+  ASSERT_FALSE(mv.unsubscribe(id));
+  mv = 100;
+  ASSERT_EQ(11U, mv.getSequence());
+  ASSERT_EQ(4U, seen.size());
+  ASSERT_EQ(143, sum);
+
+  // clearing the history writes the 'zero' value
+  mv.clearHistory();
+  ASSERT_EQ(12U, mv.getSequence());
+  ASSERT_TRUE(mv.unsubscribe(id2));
+}
+// collect the values of an update stream until it is closed
+template <typename T>
+memvar::task collectUpdates(memvar::updateStream<T>& stream, std::vector<T>& values)
+{
+  while ( auto value = co_await stream.next() )
+  {
+    values.push_back(*value);
+  }
+}
+
+memvar::task failingTask(memvar::updateStream<int>& stream)
+{
+  co_await stream.next();
+  throw std::runtime_error("failingTask");
+}
+
+TEST(memVarCoroTest, test_0)
+{
+  memvar::eventLoop loop {};
+  memvar::memvar<int> mv {0, 4};
+  auto stream {memvar::updates(mv, loop)};
+  std::vector<int> values {};
+
+  loop.spawn(collectUpdates(stream, values));
+  ASSERT_EQ(1U, loop.getTaskCount());
+  // the task runs up to the first co_await
+  ASSERT_EQ(1U, loop.run());
+  ASSERT_TRUE(values.empty());
+  // nothing to resume
+  ASSERT_EQ(0U, loop.run());
+
+  mv = 1;
+  ASSERT_EQ(1U, loop.run());
+  ASSERT_EQ(std::vector<int> ({1}), values);
+
+  // the values written while the task is not running are queued
+  mv = 2;
+  mv = 3;
+  ++mv;
+  ASSERT_EQ(3U, stream.getPendingCount());
+  ASSERT_EQ(1U, loop.run());
+  ASSERT_EQ(std::vector<int> ({1, 2, 3, 4}), values);
+
+  // closing the stream completes the task
+  mv = 5;
+  stream.close();
+  mv = 6;
+  loop.run();
+  ASSERT_EQ(std::vector<int> ({1, 2, 3, 4, 5}), values);
+  ASSERT_EQ(0U, loop.getTaskCount());
+}
+
+TEST(memVarCoroTest, test_1)
+{
+  memvar::eventLoop loop {};
+  memvar::memvarTimed<std::string> mvt {"A"};
+  memvar::memvar<int> mv {};
+  std::vector<std::string> strings {};
+  std::vector<int> ints {};
+
+  {
+    auto stringStream {memvar::updates(mvt, loop)};
+    auto intStream {memvar::updates(mv, loop)};
+    loop.spawn(collectUpdates(stringStream, strings));
+    loop.spawn(collectUpdates(intStream, ints));
+    loop.run();
+
+    mvt = "B";
+    mv = 1;
+    mvt += std::string {"C"};
+    loop.run();
+    ASSERT_EQ(std::vector<std::string> ({"B", "BC"}), strings);
+    ASSERT_EQ(std::vector<int> ({1}), ints);
+    ASSERT_EQ(2U, loop.getTaskCount());
+  }
+  // the streams are closed when they go away
+  loop.run();
+  ASSERT_EQ(0U, loop.getTaskCount());
+
+  auto stream {memvar::updates(mv, loop)};
+  loop.spawn(failingTask(stream));
+  loop.run();
+  mv = 2;
+  EXPECT_THROW(loop.run(), std::runtime_error);
+  ASSERT_EQ(0U, loop.getTaskCount());
+}
+TEST(memVarCoroTest, test_2)
+{
+  memvar::eventLoop loop {};
+  memvar::memvar<int> mv {0, 4};
+  std::vector<memvar::updateStream<int>> streams {};
+  // the tasks hold references to the streams
+  streams.reserve(3);
+  std::vector<std::vector<int>> values (3);
+  for (auto& v : values)
+  {
+    streams.push_back(memvar::updates(mv, loop));
+    loop.spawn(collectUpdates(streams.back(), v));
+  }
+  loop.run();
+
+  // a bulk append queues the values still in the history, oldest first
+  mv.append(std::vector<int> {1, 2});
+  mv.append(std::vector<int> {3, 4, 5, 6, 7});
+  ASSERT_EQ(6U, streams[0].getPendingCount());
+  loop.run();
+  ASSERT_EQ(std::vector<int> ({1, 2, 4, 5, 6, 7}), values[0]);
+  ASSERT_EQ(values[0], values[2]);
+
+  // the tasks complete in any order
+  streams[1].close();
+  loop.run();
+  ASSERT_EQ(2U, loop.getTaskCount());
+  mv = 8;
+  streams[0].close();
+  loop.run();
+  ASSERT_EQ(1U, loop.getTaskCount());
+  ASSERT_EQ(8, values[2].back());
+  streams[2].close();
+  loop.run();
+  ASSERT_EQ(0U, loop.getTaskCount());
+}
+TEST(memVarSharedTest, test_0)
+{
+  const std::string name {"/memvar-unit-tests-" + std::to_string(::getpid())};
+  EXPECT_THROW(memvar::memvarSharedReader<int64_t> mvsr {name}, std::system_error);
+
+  memvar::memvarShared<int64_t> mvs {name, 0, 5};
+  // only one writer
+  EXPECT_THROW(memvar::memvarShared<int64_t> mvs2 (name), std::system_error);
+  // the reader must agree on the types
+  EXPECT_THROW(memvar::memvarSharedReader<int32_t> mvsr {name}, std::invalid_argument);
+
+  memvar::memvarSharedReader<int64_t> mvsr {name};
+  ASSERT_EQ(5, mvsr.getHistoryCapacity());
+  ASSERT_EQ(1, mvsr.getHistorySize());
+  ASSERT_EQ(0, mvsr);
+
+  for (int64_t i {1}; i <= 100; ++i)
+  {
+    mvs = i;
+  }
+  ASSERT_EQ(100, mvs());
+  ASSERT_EQ(100, mvsr());
+  ASSERT_EQ(98, mvsr(2));
+  ASSERT_EQ(5, mvsr.getHistorySize());
+  ASSERT_EQ(101U, mvsr.getWriteCount());
+  ASSERT_EQ(100U, mvsr.getSequence());
+  ASSERT_TRUE(std::get<bool>(mvsr.getHistoryValue(5)));
+  ASSERT_EQ(mvs.getTimeTag(1), mvsr.getTimeTag(1));
+
+  std::vector<int64_t> values {};
+  std::chrono::nanoseconds last {0};
+  mvsr.forEach([&values, &last] (const int64_t value, const std::chrono::nanoseconds timeTag)
+  {
+    values.push_back(value);
+    ASSERT_LE(last, timeTag);
+    last = timeTag;
+  });
+  ASSERT_EQ(std::vector<int64_t> ({96, 97, 98, 99, 100}), values);
+}
+
+TEST(memVarSharedTest, test_1)
+{
+  // the fields are all equal when a value is not torn
+  struct quad
+  {
+    uint64_t a, b, c, d;
+  };
+  constexpr uint64_t writes {200'000};
+  const std::string name {"/memvar-unit-tests-" + std::to_string(::getpid())};
+  memvar::memvarShared<quad> mvs {name, quad {0, 0, 0, 0}, 16};
+
+  const pid_t reader {::fork()};
+  ASSERT_NE(-1, reader);
+  if ( 0 == reader )
+  {
+    // the child process reads until the last value is written
+    memvar::memvarSharedReader<quad> mvsr {name};
+    quad current {};
+    uint64_t last {0};
+    do
+    {
+      current = mvsr();
+      if ( (current.a != current.b) || (current.a != current.c) || (current.a != current.d) || (current.a < last) )
+      {
+        ::_exit(1);
+      }
+      last = current.a;
+    } while ( current.a != writes );
+    ::_exit(0);
+  }
+
+  for (uint64_t i {1}; i <= writes; ++i)
+  {
+    mvs = quad {i, i, i, i};
+  }
+  int status {0};
+  ASSERT_EQ(reader, ::waitpid(reader, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+}
+TEST(memVarSharedTest, test_2)
+{
+  // an object left behind by a writer that crashed before it was set up
+  const std::string name {"/memvar-unit-tests-" + std::to_string(::getpid())};
+  const int fd {::shm_open(name.c_str(), O_CREAT | O_RDWR, 0644)};
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ(0, ::ftruncate(fd, 4'096));
+  ::close(fd);
+  EXPECT_THROW(memvar::memvarSharedReader<int64_t> mvsr {name}, std::runtime_error);
+  EXPECT_THROW(memvar::memvarShared<int64_t> mvs (name), std::system_error);
+
+  memvar::memvarShared<int64_t> mvs {name, 1, 5, memvar::sharedOpenMode::replace};
+  memvar::memvarSharedReader<int64_t> mvsr {name};
+  ASSERT_EQ(1, mvsr());
+  // the time points of the writer are known to the readers
+  const auto now {std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())};
+  ASSERT_EQ(mvs.getEpoch(), mvsr.getEpoch());
+  ASSERT_LE(mvsr.getEpoch(), now);
+  ASSERT_GT(mvsr.getEpoch(), now - std::chrono::minutes {1});
+
+  // a ring not a power of two, or not larger than the history, is refused
+  const int rw {::shm_open(name.c_str(), O_RDWR, 0)};
+  ASSERT_NE(-1, rw);
+  void* address {::mmap(nullptr, sizeof(memvar::detail::sharedHeader), PROT_READ | PROT_WRITE, MAP_SHARED, rw, 0)};
+  ::close(rw);
+  ASSERT_NE(MAP_FAILED, address);
+  auto* header {static_cast<memvar::detail::sharedHeader*>(address)};
+  const auto ringSize {header->ringSize_};
+  header->ringSize_ = 6;
+  EXPECT_THROW(memvar::memvarSharedReader<int64_t> bad {name}, std::runtime_error);
+  header->ringSize_ = 4;
+  EXPECT_THROW(memvar::memvarSharedReader<int64_t> bad {name}, std::runtime_error);
+  header->ringSize_ = ringSize;
+  ::munmap(address, sizeof(memvar::detail::sharedHeader));
+}
+TEST(memVarSharedTest, test_3)
+{
+  const std::string name {"/memvar-unit-tests-" + std::to_string(::getpid())};
+  memvar::memvarShared<int64_t> mvs {name, 0, 5};
+  memvar::memvarSharedReader<int64_t> mvsr {name};
+  ASSERT_EQ(7, mvs.getMaxHistoryCapacity());
+  EXPECT_THROW(mvs.setHistoryCapacity(1), std::invalid_argument);
+  EXPECT_THROW(mvs.setHistoryCapacity(8), std::invalid_argument);
+  for (int64_t i {1}; i <= 10; ++i)
+  {
+    mvs = i;
+  }
+
+  // the readers see the new capacity, and the values dropped by a shrink do
+  // not come back when the capacity grows
+  mvs.setHistoryCapacity(3);
+  ASSERT_EQ(3, mvsr.getHistoryCapacity());
+  ASSERT_EQ(3, mvsr.getHistorySize());
+  ASSERT_EQ(8, mvsr(2));
+  mvs.setHistoryCapacity(7);
+  ASSERT_EQ(7, mvsr.getHistoryCapacity());
+  ASSERT_EQ(3, mvsr.getHistorySize());
+  for (int64_t i {11}; i <= 20; ++i)
+  {
+    mvs = i;
+  }
+  ASSERT_EQ(7, mvsr.getHistorySize());
+  std::vector<int64_t> values {};
+  mvsr.forEach([&values] (const int64_t value, std::chrono::nanoseconds) { values.push_back(value); });
+  ASSERT_EQ(std::vector<int64_t> ({14, 15, 16, 17, 18, 19, 20}), values);
+}
+TEST(memVarRegistryTest, test_0)
+{
+  memvar::memvarRegistry<memvar::memvar<int>> registry {};
+  ASSERT_EQ(64U, registry.getShardCount());
+  ASSERT_EQ(nullptr, registry.find("a"));
+
+  auto [a, created] = registry.tryEmplace("a", 1, 5);
+  ASSERT_TRUE(created);
+  ASSERT_EQ(1, a);
+  ASSERT_EQ(5, a.getHistoryCapacity());
+  a = 2;
+  // the arguments are ignored if the memvar exists
+  auto& a2 {registry.getOrCreate("a", 100)};
+  ASSERT_EQ(&a, &a2);
+  ASSERT_EQ(2, a2);
+  ASSERT_EQ(1, a2(1));
+
+  // the tables grow, and the memvars stay where they are
+  for (int i {0}; i < 1'000; ++i)
+  {
+    registry.getOrCreate("v" + std::to_string(i), i);
+  }
+  ASSERT_EQ(1'001U, registry.size());
+  ASSERT_EQ(&a, registry.find("a"));
+  ASSERT_EQ(999, *registry.find("v999"));
+  ASSERT_TRUE(registry.contains("v0"));
+  ASSERT_FALSE(registry.contains("v1000"));
+
+  size_t count {0};
+  int sum {0};
+  registry.forEach([&count, &sum] (const std::string&, const memvar::memvar<int>& mv)
+  {
+    ++count;
+    sum += mv();
+  });
+  ASSERT_EQ(1'001U, count);
+  ASSERT_EQ(2 + 999 * 1'000 / 2, sum);
+
+  // one shard
+  memvar::memvarRegistry<memvar::memvar<int>, int> intRegistry {1};
+  for (int i {0}; i < 100; ++i)
+  {
+    intRegistry.getOrCreate(i, i * i);
+  }
+  ASSERT_EQ(81, *intRegistry.find(9));
+}
+
+TEST(memVarRegistryTest, test_1)
+{
+  // the threads create and look up the same keys: each memvar is created once
+  constexpr int keys {10'000};
+  constexpr int threadCount {4};
+  memvar::memvarRegistry<memvar::memvarConcurrent<int64_t>, int> registry {};
+  std::atomic<int> created {0};
+  {
+    std::vector<std::jthread> threads {};
+    for (int t {0}; t < threadCount; ++t)
+    {
+      threads.emplace_back([&registry, &created, t] ()
+      {
+        for (int k {0}; k < keys; ++k)
+        {
+          const int key {(k + t * keys / threadCount) % keys};
+          auto [mvc, isNew] = registry.tryEmplace(key, key);
+          if ( isNew )
+          {
+            ++created;
+          }
+          ASSERT_EQ(key, mvc());
+          ASSERT_EQ(&mvc, registry.find(key));
+        }
+      });
+    }
+  }
+  ASSERT_EQ(keys, created);
+  ASSERT_EQ(static_cast<size_t>(keys), registry.size());
+
+  std::atomic<int64_t> sum {0};
+  std::atomic<int> visited {0};
+  registry.parallelForEach([&sum, &visited] (const int, const memvar::memvarConcurrent<int64_t>& mvc)
+  {
+    sum += mvc();
+    ++visited;
+  }, 4);
+  ASSERT_EQ(keys, visited);
+  ASSERT_EQ(static_cast<int64_t>(keys) * (keys - 1) / 2, sum);
+}
+TEST(memFrameTest, test_0)
+{
+  // bid, ask, size
+  using quote = memvar::memframe<double, double, int64_t>;
+  EXPECT_THROW(quote mf({0.0, 0.0, 0}, 1), std::invalid_argument);
+
+  quote mf {{1.0, 1.5, 100}, 3};
+  ASSERT_EQ(3U, quote::columnCount_);
+  ASSERT_EQ(1, mf.getHistorySize());
+  ASSERT_EQ(quote::row(1.0, 1.5, 100), mf());
+
+  mf.setRow(2.0, 2.5, 200);
+  mf = {3.0, 3.5, 300};
+  mf.setRow(quote::row {4.0, 4.5, 400});
+  ASSERT_TRUE(mf.isHistoryFull());
+  ASSERT_EQ(3, mf.getHistorySize());
+  ASSERT_EQ(quote::row(4.0, 4.5, 400), mf());
+  ASSERT_EQ(quote::row(2.0, 2.5, 200), mf(2));
+  ASSERT_EQ(3.5, mf.get<1>(1));
+  ASSERT_EQ(400, mf.get<2>());
+  ASSERT_EQ(std::deque<int64_t> ({400, 300, 200}), mf.getColumnHistory<2>());
+
+  // one time tag per row
+  ASSERT_LE(mf.getTimeTag(1), mf.getTimeTag(0));
+  const auto [row, timeTag, outOfBound] = mf.getHistoryRow(1);
+  ASSERT_FALSE(outOfBound);
+  ASSERT_EQ(quote::row(3.0, 3.5, 300), row);
+  ASSERT_EQ(mf.getTimeTag(1), timeTag);
+  ASSERT_TRUE(std::get<bool>(mf.getHistoryRow(3)));
+  ASSERT_EQ(quote::row(), mf(3));
+
+  std::vector<quote::row> rows(4);
+  ASSERT_EQ(3, mf.copyRowsTo(rows, 4, memvar::historyOrder::oldestFirst));
+  ASSERT_EQ(quote::row(2.0, 2.5, 200), rows[0]);
+  ASSERT_EQ(quote::row(4.0, 4.5, 400), rows[2]);
+  std::vector<double> bids(2);
+  ASSERT_EQ(2, mf.copyColumnTo<0>(bids, 2));
+  ASSERT_EQ(std::vector<double> ({4.0, 3.0}), bids);
+}
+
+TEST(memFrameTest, test_1)
+{
+  memvar::memframe<std::string, int> mf {{"a", 1}, 10};
+  for (int i {2}; i <= 6; ++i)
+  {
+    mf.setRow(std::string(1, static_cast<char>('a' + i - 1)), i);
+  }
+  ASSERT_EQ(6, mf.getHistorySize());
+
+  mf.setHistoryCapacity(4);
+  ASSERT_EQ(4, mf.getHistorySize());
+  ASSERT_EQ(std::deque<int> ({6, 5, 4, 3}), mf.getColumnHistory<1>());
+  ASSERT_EQ("c", mf.get<0>(3));
+  ASSERT_THROW(mf.getTimeTag(4), std::out_of_range);
+
+  std::ostringstream os {};
+  mf.printHistoryData(os, " ");
+  ASSERT_THAT(os.str(), HasSubstr(":f,6]"));
+  ASSERT_THAT(os.str(), HasSubstr(":c,3]"));
+
+  mf.clearHistory();
+  ASSERT_EQ(1, mf.getHistorySize());
+  ASSERT_EQ((std::tuple<std::string, int> {"", 0}), mf());
+  ASSERT_EQ(0, mf.getTimeTag().count());
+  mf.setRow("x", 1);
+  ASSERT_EQ(2, mf.getHistorySize());
+
+  auto moved {std::move(mf)};
+  ASSERT_EQ("x", moved.get<0>());
+}
+TEST(memVarPersisterTest, test_0)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".log")).string()};
+  std::filesystem::remove(path);
+  // no log yet
+  memvar::memvarTimed<int64_t> restored {0, 100};
+  ASSERT_EQ(0U, memvar::replayLog(path, restored));
+
+  memvar::memvarTimed<int64_t> mvt {0, 100};
+  {
+    memvar::memvarPersister<int64_t> persister {mvt, path, 16};
+    for (int64_t i {1}; i <= 1'000; ++i)
+    {
+      mvt = i;
+    }
+    // the values of a bulk append are logged one by one
+    const std::vector<int64_t> values {1'001, 1'002, 1'003};
+    mvt.append(values);
+    persister.flush();
+    ASSERT_EQ(1'003U, persister.getPersistedCount());
+    mvt = 1'004;
+  }
+  ASSERT_EQ(1'004U, memvar::replayLog(path, restored));
+  ASSERT_EQ(100, restored.getHistorySize());
+  for (memvar::memvarBase::capacityType i {0}; i < 100; ++i)
+  {
+    ASSERT_EQ(mvt(i), restored(i));
+    ASSERT_EQ(mvt.getTimePoint(static_cast<size_t>(i)), restored.getTimePoint(static_cast<size_t>(i)));
+  }
+
+  // a persister appends to the log, and a torn record ends it
+  {
+    memvar::memvarPersister<int64_t> persister {mvt, path};
+    mvt = 1'005;
+    mvt = 1'006;
+  }
+  const auto logSize {std::filesystem::file_size(path)};
+  std::filesystem::resize_file(path, logSize - 1);
+  memvar::memvarTimed<int64_t> restoredAgain {0, 10};
+  ASSERT_EQ(1'005U, memvar::replayLog(path, restoredAgain));
+  ASSERT_EQ(1'005, restoredAgain());
+  {
+    // the torn record is cut off when the log is opened again
+    memvar::memvarPersister<int64_t> persister {mvt, path};
+    constexpr auto recordSize {memvar::detail::logRecordSize<int64_t, std::chrono::nanoseconds>};
+    ASSERT_EQ(logSize - recordSize, std::filesystem::file_size(path));
+    mvt = 1'007;
+  }
+  memvar::memvarTimed<int64_t> restoredLast {0, 10};
+  ASSERT_EQ(1'006U, memvar::replayLog(path, restoredLast));
+  ASSERT_EQ(1'007, restoredLast());
+  ASSERT_EQ(1'005, restoredLast(1));
+
+  // the types must match, the unit of the time points too
+  memvar::memvarTimed<int32_t> wrongType {};
+  EXPECT_THROW(memvar::replayLog(path, wrongType), std::invalid_argument);
+  memvar::memvarTimed<int64_t, std::chrono::duration<int64_t, std::pico>> wrongUnit {};
+  EXPECT_THROW(memvar::replayLog(path, wrongUnit), std::invalid_argument);
+  std::filesystem::remove(path);
+}
+TEST(memVarPersisterTest, test_1)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".wal")).string()};
+  std::filesystem::remove(path);
+
+  memvar::memvarTimed<double> mvt {0.0, 1'000};
+  {
+    // group commit: a sync every 64 values, or 500 microseconds after the
+    // oldest value not synced yet
+    memvar::memvarPersister<double> persister {mvt, path, 1'024, std::chrono::microseconds {100},
+                                               memvar::logSyncPolicy {64, std::chrono::microseconds {500}}};
+    for (int i {1}; i <= 1'000; ++i)
+    {
+      mvt = i * 0.5;
+    }
+    persister.sync();
+    ASSERT_EQ(1'000U, persister.getDurableCount());
+    ASSERT_GT(persister.getSyncCount(), 0U);
+    ASSERT_LE(persister.getSyncCount(), 1'000U / 64 + 2);
+
+    // a single value is synced after the interval, with no sync() call
+    mvt = -1.0;
+    const auto deadline {std::chrono::steady_clock::now() + std::chrono::seconds {5}};
+    while ( (persister.getDurableCount() < 1'001U) && (std::chrono::steady_clock::now() < deadline) )
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds {100});
+    }
+    ASSERT_EQ(1'001U, persister.getDurableCount());
+  }
+
+  // the current value and the history are rebuilt by replaying the log
+  memvar::memvarTimed<double> restored {0.0, 1'000};
+  ASSERT_EQ(1'001U, memvar::replayLog(path, restored));
+  ASSERT_EQ(-1.0, restored());
+  for (memvar::memvarBase::capacityType i {0}; i < 1'000; ++i)
+  {
+    ASSERT_EQ(mvt(i), restored(i));
+  }
+  std::filesystem::remove(path);
+}
+TEST(memVarFileTest, test_0)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".mvh")).string()};
+
+  memvar::memvarTimed<int64_t> mvt {0, 100};
+  for (int64_t i {1}; i <= 150; ++i)
+  {
+    mvt = i * i;
+  }
+  memvar::saveHistory(path, mvt);
+
+  // loaded in place
+  const memvar::mappedHistory<int64_t> mapped {path};
+  ASSERT_TRUE(mapped.isTimed());
+  ASSERT_EQ(100, mapped.getHistoryCapacity());
+  ASSERT_EQ(100, mapped.getHistorySize());
+  ASSERT_EQ(150 * 150, mapped());
+  ASSERT_EQ(51 * 51, mapped(99));
+  ASSERT_TRUE(std::get<bool>(mapped.getHistoryValue(100)));
+  ASSERT_EQ(mvt.getTimeTag(10), mapped.getTimeTag(10));
+  ASSERT_EQ((mvt.getTimePoint() - mvt.getTimeTag()).time_since_epoch(), mapped.getEpoch());
+  ASSERT_EQ(51 * 51, mapped.getValues().front());
+  ASSERT_EQ(100U, mapped.getTimeTags().size());
+  ASSERT_THROW(mapped.getTimeTag(100), std::out_of_range);
+
+  // parsed into a memvar
+  memvar::memvarTimed<int64_t> restored {0, 100};
+  ASSERT_EQ(100U, memvar::loadHistory(path, restored));
+  for (memvar::memvarBase::capacityType i {0}; i < 100; ++i)
+  {
+    ASSERT_EQ(mvt(i), restored(i));
+    ASSERT_EQ(mvt.getTimePoint(static_cast<size_t>(i)), restored.getTimePoint(static_cast<size_t>(i)));
+  }
+
+  // the types must match
+  EXPECT_THROW(memvar::mappedHistory<double> {path}, std::invalid_argument);
+  memvar::memvar<uint64_t> wrongType {};
+  EXPECT_THROW(memvar::loadHistory(path, wrongType), std::invalid_argument);
+  std::filesystem::remove(path);
+  EXPECT_THROW(memvar::mappedHistory<int64_t> {path}, std::system_error);
+}
+
+TEST(memVarFileTest, test_1)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".mvh")).string()};
+
+  memvar::memvar<std::string> mvs {"zero", 5};
+  mvs = "one";
+  mvs = "";
+  mvs = "three";
+  memvar::saveHistory(path, mvs);
+  memvar::memvar<std::string> restored {"x", 10};
+  ASSERT_EQ(4U, memvar::loadHistory(path, restored));
+  ASSERT_EQ(5, restored.getHistorySize());
+  ASSERT_EQ("three", restored());
+  ASSERT_EQ("", restored(1));
+  ASSERT_EQ("zero", restored(3));
+  ASSERT_EQ("x", restored(4));
+
+  memvar::memvar<double> mvd {0.5};
+  mvd = 1.5;
+  memvar::saveHistory(path, mvd);
+  const memvar::mappedHistory<double> mapped {path};
+  ASSERT_FALSE(mapped.isTimed());
+  ASSERT_EQ(1.5, mapped());
+  ASSERT_EQ(0.5, mapped(1));
+  ASSERT_TRUE(mapped.getTimeTags().empty());
+  std::filesystem::remove(path);
+}
+TEST(memVarFileTest, test_2)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".mvh")).string()};
+
+  // the time tags are read back in the unit they were saved in only
+  using picoseconds = std::chrono::duration<int64_t, std::pico>;
+  memvar::memvarTimed<int64_t> mvt {0, 10};
+  mvt = 1;
+  memvar::saveHistory(path, mvt);
+  memvar::memvarTimed<int64_t, picoseconds> wrongUnit {0, 10};
+  EXPECT_THROW(memvar::loadHistory(path, wrongUnit), std::invalid_argument);
+  EXPECT_THROW((memvar::mappedHistory<int64_t, picoseconds> {path}), std::invalid_argument);
+  const memvar::mappedHistory<int64_t> mapped {path};
+  ASSERT_EQ(mvt.getTimeTag(), mapped.getTimeTag());
+
+  // a column out of the file, or misaligned, is not mapped
+  auto corrupt = [&path] (const size_t offset, const uint64_t value)
+  {
+    std::fstream fs {path, std::ios::binary | std::ios::in | std::ios::out};
+    fs.seekp(static_cast<std::streamoff>(offset));
+    fs.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  corrupt(offsetof(memvar::detail::historyFileHeader, timeTagsOffset_), uint64_t {1} << 62);
+  EXPECT_THROW(memvar::mappedHistory<int64_t> {path}, std::runtime_error);
+  memvar::saveHistory(path, mvt);
+  corrupt(offsetof(memvar::detail::historyFileHeader, valuesOffset_), sizeof(memvar::detail::historyFileHeader) + 4);
+  EXPECT_THROW(memvar::mappedHistory<int64_t> {path}, std::runtime_error);
+  memvar::saveHistory(path, mvt);
+  corrupt(offsetof(memvar::detail::historyFileHeader, historySize_), uint64_t {1} << 61);
+  EXPECT_THROW(memvar::mappedHistory<int64_t> {path}, std::runtime_error);
+
+  // nor is it allocated when the file is parsed
+  memvar::memvarTimed<int64_t> restored {0, 10};
+  EXPECT_THROW(memvar::loadHistory(path, restored), std::runtime_error);
+  memvar::memvar<std::string> mvs {"zero", 5};
+  mvs = "one";
+  memvar::saveHistory(path, mvs);
+  corrupt(offsetof(memvar::detail::historyFileHeader, historySize_), uint64_t {1} << 61);
+  memvar::memvar<std::string> restoredString {"x", 5};
+  EXPECT_THROW(memvar::loadHistory(path, restoredString), std::runtime_error);
+  memvar::saveHistory(path, mvs);
+  // the length of the first string
+  corrupt(memvar::detail::alignHistoryFile(sizeof(memvar::detail::historyFileHeader)), uint64_t {1} << 60);
+  EXPECT_THROW(memvar::loadHistory(path, restoredString), std::runtime_error);
+  ASSERT_EQ("x", restoredString());
+  std::filesystem::remove(path);
+}
+TEST(memVarExportTest, test_0)
+{
+  memvar::memvar<int> mv {1, 5};
+  mv = 2;
+  mv = -3;
+
+  // no backspaces to hide the last separator
+  std::ostringstream printed {};
+  mv.printHistoryData(printed);
+  ASSERT_EQ("[ -3 2 1 ]\n", printed.str());
+  printed.str("");
+  mv.printReverseHistoryData(printed, ", ");
+  ASSERT_EQ("[ 1, 2, -3 ]\n", printed.str());
+
+  std::ostringstream exported {};
+  memvar::exportHistory(exported, mv, memvar::exportFormat::bracket);
+  ASSERT_EQ("[ -3 2 1 ]\n", exported.str());
+  exported.str("");
+  memvar::exportHistory(exported, mv, memvar::exportFormat::csv, memvar::historyOrder::oldestFirst);
+  ASSERT_EQ("value\n1\n2\n-3\n", exported.str());
+  exported.str("");
+  memvar::exportHistory(exported, mv, memvar::exportFormat::jsonLines);
+  ASSERT_EQ("{\"value\":-3}\n{\"value\":2}\n{\"value\":1}\n", exported.str());
+
+  // the floating point numbers are printed as by the stream, and exported
+  // in the shortest form that reads back the same
+  memvar::memvar<double> mvd {0.1, 5};
+  mvd += 0.2;
+  mvd = std::numeric_limits<double>::infinity();
+  printed.str("");
+  mvd.printReverseHistoryData(printed);
+  ASSERT_EQ("[ 0.1 0.3 inf ]\n", printed.str());
+  exported.str("");
+  memvar::exportHistory(exported, mvd, memvar::exportFormat::jsonLines, memvar::historyOrder::oldestFirst);
+  ASSERT_EQ("{\"value\":0.1}\n{\"value\":0.30000000000000004}\n{\"value\":null}\n", exported.str());
+}
+
+TEST(memVarExportTest, test_1)
+{
+  memvar::memvarTimed<std::string> mvt {"plain", 5};
+  mvt = "a,b";
+  mvt = "say \"hi\"\n";
+
+  std::ostringstream exported {};
+  memvar::exportHistory(exported, mvt, memvar::exportFormat::csv, memvar::historyOrder::oldestFirst);
+  const auto t1 {std::to_string(mvt.getTimeTag(1).count())};
+  const auto t2 {std::to_string(mvt.getTimeTag(0).count())};
+  ASSERT_EQ("timeTag,value\n0,plain\n" + t1 + ",\"a,b\"\n" + t2 + ",\"say \"\"hi\"\"\n\"\n", exported.str());
+  exported.str("");
+  memvar::exportHistory(exported, mvt, memvar::exportFormat::jsonLines);
+  ASSERT_EQ("{\"timeTag\":" + t2 + ",\"value\":\"say \\\"hi\\\"\\n\"}\n"
+            "{\"timeTag\":" + t1 + ",\"value\":\"a,b\"}\n"
+            "{\"timeTag\":0,\"value\":\"plain\"}\n", exported.str());
+
+  // the bracket style is the one of the printer
+  std::ostringstream printed {};
+  mvt.printHistoryTimedData(printed);
+  exported.str("");
+  memvar::exportHistory(exported, mvt, memvar::exportFormat::bracket);
+  ASSERT_EQ(printed.str(), exported.str());
+
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".csv")).string()};
+  memvar::memvar<bip::bigint> mvb {bip::bigint {"123456789012345678901234567890"}};
+  memvar::exportHistory(path, mvb, memvar::exportFormat::csv);
+  std::ifstream is {path};
+  const std::string text {std::istreambuf_iterator<char> {is}, std::istreambuf_iterator<char> {}};
+  ASSERT_EQ("value\n123456789012345678901234567890\n", text);
+  std::filesystem::remove(path);
+
+  // a full device fails the writes of a large history, and the close of a
+  // small one
+  memvar::memvar<int64_t> large {0, 1'000'000};
+  for (int64_t i {1}; i < 1'000'000; ++i)
+  {
+    large = i;
+  }
+  EXPECT_THROW(memvar::exportHistory("/dev/full", large, memvar::exportFormat::csv), std::system_error);
+  EXPECT_THROW(memvar::exportHistory("/dev/full", mvb, memvar::exportFormat::csv), std::system_error);
+}
+TEST(memVarExportTest, test_2)
+{
+  memvar::memvar<bool> mv {false, 5};
+  mv = true;
+  std::ostringstream printed {};
+  mv.printHistoryData(printed);
+  ASSERT_EQ("[ 1 0 ]\n", printed.str());
+  printed.str("");
+  printed << std::boolalpha;
+  mv.printHistoryData(printed);
+  ASSERT_EQ("[ true false ]\n", printed.str());
+  printed.str("");
+  mv.printLifetimeStats(printed);
+  ASSERT_EQ("{ writes: 1, unchanged: 0, evictions: 0, min: false #0, max: true #1, sum: 1 }\n", printed.str());
+
+  std::ostringstream exported {};
+  memvar::exportHistory(exported, mv, memvar::exportFormat::csv);
+  ASSERT_EQ("value\n1\n0\n", exported.str());
+  exported.str("");
+  memvar::exportHistory(exported, mv, memvar::exportFormat::jsonLines);
+  ASSERT_EQ("{\"value\":true}\n{\"value\":false}\n", exported.str());
+
+  memvar::memvarTimed<bool> mvt {true, 5};
+  printed.str("");
+  printed << std::noboolalpha;
+  mvt.printHistoryTimedData(printed);
+  ASSERT_EQ("{ --- begin ---\n[TimeTag:Value]\n[0:1]\n  --- end --- }\n\n", printed.str());
+
+  // the flags of the stream are honored by the printers, as by operator<<
+  memvar::memvar<int> mvi {255, 5};
+  printed.str("");
+  printed << std::hex;
+  mvi.printHistoryData(printed);
+  ASSERT_EQ("[ ff ]\n", printed.str());
+  memvar::memvar<double> mvd {0.1, 5};
+  printed.str("");
+  printed << std::fixed << std::setprecision(2);
+  mvd.printHistoryData(printed);
+  ASSERT_EQ("[ 0.10 ]\n", printed.str());
+  printed.str("");
+  printed << std::scientific << std::uppercase;
+  mvd.printHistoryData(printed);
+  ASSERT_EQ("[ 1.00E-01 ]\n", printed.str());
+}
+TEST(memVarUtf8Test, test_0)
+{
+  // ASCII runs longer than a block, 2, 3 and 4 byte sequences
+  const std::string expected {"memvar history: \u00e9t\u00e9 \u20ac \U0001f600 end of a long ASCII run"};
+  std::string out {};
+  ASSERT_EQ(expected, memvar::appendUtf8(out, std::u16string_view(u"memvar history: \u00e9t\u00e9 \u20ac \U0001f600 end of a long ASCII run")));
+  // appended to the text already there
+  out = "prefix ";
+  memvar::appendUtf8(out, std::u32string_view(U"memvar history: \u00e9t\u00e9 \u20ac \U0001f600 end of a long ASCII run"));
+  ASSERT_EQ("prefix " + expected, out);
+
+  std::ostringstream os {};
+  os << std::wstring {L"memvar history: \u00e9t\u00e9 \u20ac \U0001f600 end of a long ASCII run"};
+  ASSERT_EQ(expected, os.str());
+
+  // lone surrogates and values out of the code point range are replaced
+  out.clear();
+  memvar::appendUtf8(out, std::u16string_view(u"a\xd800" u"b\xdc00"));
+  ASSERT_EQ("a\xef\xbf\xbd" "b\xef\xbf\xbd", out);
+  out.clear();
+  memvar::appendUtf8(out, std::u32string_view(U"x\x110000"));
+  ASSERT_EQ("x\xef\xbf\xbd", out);
+
+  // long texts are written a chunk at a time without splitting a surrogate
+  // pair across two chunks
+  std::u16string longText(2047, u'a');
+  for (int i {0}; i < 1000; ++i) {
+    longText += u"\U0001f600\u00e9";
+  }
+  os.str("");
+  os << longText;
+  std::string longExpected(2047, 'a');
+  for (int i {0}; i < 1000; ++i) {
+    longExpected += "\U0001f600\u00e9";
+  }
+  ASSERT_EQ(longExpected, os.str());
+}
+
+TEST(memVarUtf8Test, test_1)
+{
+  memvar::memvar<std::u16string> mv {u"caf\u00e9", 5};
+  mv = u"na\u00efve, \"quoted\"";
+
+  std::ostringstream printed {};
+  mv.printReverseHistoryData(printed);
+  ASSERT_EQ("[ caf\u00e9 na\u00efve, \"quoted\" ]\n", printed.str());
+
+  std::ostringstream exported {};
+  memvar::exportHistory(exported, mv, memvar::exportFormat::csv);
+  ASSERT_EQ("value\n\"na\u00efve, \"\"quoted\"\"\"\ncaf\u00e9\n", exported.str());
+  exported.str("");
+  memvar::memvarTimed<std::wstring> mvt {L"\u20ac", 5};
+  memvar::exportHistory(exported, mvt, memvar::exportFormat::jsonLines);
+  ASSERT_EQ("{\"timeTag\":0,\"value\":\"\u20ac\"}\n", exported.str());
+}
+TEST(memVarArrowTest, test_0)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".arrow")).string()};
+  auto readFile = [&path] () {
+    std::ifstream is {path, std::ios::binary};
+    return std::string {std::istreambuf_iterator<char> {is}, std::istreambuf_iterator<char> {}};
+  };
+
+  memvar::memvarTimed<int64_t> mvt {1, 100};
+  for (int64_t i {2}; i <= 40; ++i) {
+    mvt = i;
+  }
+  memvar::exportArrow(path, mvt, 16);
+  auto file {readFile()};
+  // an arrow IPC file: the magic at both ends, the footer before the last
+  // magic, and the values written as they are, oldest first, 16 per batch
+  ASSERT_EQ(0, file.compare(0, 8, std::string("ARROW1\0\0", 8)));
+  ASSERT_EQ("ARROW1", file.substr(file.size() - 6));
+  int32_t footerLength {0};
+  std::memcpy(&footerLength, file.data() + file.size() - 10, sizeof(footerLength));
+  ASSERT_GT(footerLength, 0);
+  ASSERT_LT(static_cast<size_t>(footerLength), file.size());
+  std::vector<int64_t> batch (16);
+  std::iota(batch.begin(), batch.end(), 17);
+  const std::string_view values {reinterpret_cast<const char*>(batch.data()), batch.size() * sizeof(int64_t)};
+  const auto at {file.find(values)};
+  ASSERT_NE(std::string::npos, at);
+  ASSERT_EQ(0u, at % 64);
+
+  // several histories in one file, the text as UTF-8
+  memvar::memvarTimed<std::u32string> mvs {U"na\u00efve", 10};
+  mvs = U"\u20ac";
+  memvar::exportArrow(path, 1024, memvar::arrowSeries {"count", mvt}, memvar::arrowSeries {"label", mvs});
+  file = readFile();
+  ASSERT_NE(std::string::npos, file.find("na\u00efve\u20ac"));
+  ASSERT_NE(std::string::npos, file.find("label.time"));
+  ASSERT_NE(std::string::npos, file.find("count.time"));
+
+  ASSERT_THROW(memvar::exportArrow(path, mvt, 0), std::invalid_argument);
+  std::filesystem::remove(path);
+}
+
+TEST(memVarArrowTest, test_1)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".arrow")).string()};
+  // histories of different lengths: the shorter ones are padded with nulls
+  // in the batches past their end
+  memvar::memvarTimed<int64_t> a {1'000, 100};
+  for (int64_t i {1'001}; i <= 1'050; ++i) {
+    a = i;
+  }
+  memvar::memvarTimed<std::string> b {"b0", 100};
+  for (int i {1}; i < 14; ++i) {
+    b = "b" + std::to_string(i);
+  }
+  memvar::memvarTimed<bool> c {true, 100};
+  c = false;
+  ASSERT_EQ(51, a.getHistorySize());
+  ASSERT_EQ(14, b.getHistorySize());
+  ASSERT_EQ(2, c.getHistorySize());
+  memvar::exportArrow(path, 5, memvar::arrowSeries {"a", a}, memvar::arrowSeries {"b", b}, memvar::arrowSeries {"c", c});
+
+  std::ifstream is {path, std::ios::binary};
+  const std::string file {std::istreambuf_iterator<char> {is}, std::istreambuf_iterator<char> {}};
+  ASSERT_EQ(0, file.compare(0, 8, std::string("ARROW1\0\0", 8)));
+  ASSERT_EQ("ARROW1", file.substr(file.size() - 6));
+  // the last batch holds the newest value of a alone, its nulls after the
+  // values of b and c
+  const int64_t newest {1'050};
+  ASSERT_NE(std::string::npos, file.find(std::string_view {reinterpret_cast<const char*>(&newest), sizeof(newest)}));
+  ASSERT_NE(std::string::npos, file.find("b0b1b2b3b4"));
+  ASSERT_NE(std::string::npos, file.find("b10b11b12b13"));
+  std::filesystem::remove(path);
+}
+
+TEST(memVarTieredTest, test_0)
+{
+  const auto path {(std::filesystem::temp_directory_path() / ("memvar-unit-tests-" + std::to_string(::getpid()) + ".spill")).string()};
+  std::filesystem::create_directory(path);
+  for (const auto& spillDirectory : {std::string {}, path})
+  {
+    // a hot tier of 100 to 164 values, cold segments of 64 values
+    memvar::memvarTiered<int64_t> mv {0, 1'000, 100, 64, spillDirectory};
+    ASSERT_EQ(!spillDirectory.empty(), mv.isSpilled());
+    // the spill file has no name in the directory
+    ASSERT_TRUE(std::filesystem::is_empty(path));
+    memvar::memvar<int64_t> expected {0, 1'000};
+    for (int64_t i {1}; i < 5'000; ++i)
+    {
+      // runs of equal deltas, constants, and jumps both ways
+      const int64_t value {(i % 500 < 100) ? expected() : (i % 7 == 0) ? -i * 1'000'003 : expected() + i % 3};
+      mv = value;
+      expected = value;
+    }
+    ASSERT_EQ(1'000, mv.getHistorySize());
+    ASSERT_TRUE(mv.isHistoryFull());
+    ASSERT_LE(mv.getHotSize(), 164U);
+    ASSERT_GT(mv.getSegmentCount(), 0U);
+    ASSERT_LT(mv.getColdBytes(), mv.getSegmentCount() * 64 * sizeof(int64_t) / 2);
+    // the reads cross the tiers transparently
+    for (memvar::memvarBase::capacityType i {0}; i < 1'000; ++i)
+    {
+      ASSERT_EQ(expected(i), mv(i));
+    }
+    ASSERT_TRUE(std::get<bool>(mv.getHistoryValue(1'000)));
+    memvar::memvarBase::capacityType n {1'000};
+    mv.forEach([&expected, &n] (const int64_t value) { ASSERT_EQ(expected(--n), value); });
+    ASSERT_EQ(0, n);
+
+    mv.setHistoryCapacity(300);
+    ASSERT_EQ(300, mv.getHistorySize());
+    ASSERT_EQ(expected(299), mv(299));
+    mv.clearHistory();
+    ASSERT_EQ(1, mv.getHistorySize());
+    ASSERT_EQ(0, mv());
+    ASSERT_EQ(0U, mv.getColdBytes());
+  }
+
+  // a file is not a spill directory, and it is left as it is
+  const auto file {path + "/file"};
+  std::ofstream {file} << "keep";
+  EXPECT_THROW((memvar::memvarTiered<int64_t> {0, 1'000, 100, 64, file}), std::system_error);
+  ASSERT_EQ(4U, std::filesystem::file_size(file));
+  std::filesystem::remove_all(path);
+
+  // any integral type round trips
+  memvar::memvarTiered<uint8_t> mvu {255, 500, 10, 16};
+  for (int i {0}; i < 2'000; ++i)
+  {
+    mvu = static_cast<uint8_t>(i * 37);
+  }
+  for (int i {0}; i < 500; ++i)
+  {
+    ASSERT_EQ(static_cast<uint8_t>((1'999 - i) * 37), mvu(i));
+  }
+}
+
+TEST(memVarRollupTest, test_0)
+{
+  using namespace std::chrono_literals;
+  using mvtType = memvar::memvarTimed<int64_t>;
+  mvtType mvt {0, 100};
+  // 1 second buckets for 1 minute, 1 minute buckets for 1 hour
+  memvar::memvarRollup<int64_t> rollup {mvt, {{1min, 1h}, {1s, 1min}}};
+  ASSERT_EQ(2U, rollup.getTierCount());
+  ASSERT_EQ(std::chrono::nanoseconds {1s}, rollup.getResolution(0));
+  ASSERT_THROW((memvar::memvarRollup<int64_t> {mvt, {{0s, 1h}}}), std::invalid_argument);
+
+  // a value every 100 ms for 2 hours
+  const mvtType::timePoint start {std::chrono::hours {1'000}};
+  for (int64_t i {0}; i < 72'000; ++i)
+  {
+    mvt.setValueAt(i % 10, start + i * 100ms);
+  }
+  const auto now {mvt.getTimePoint()};
+  // the buckets of the retention and the newest one
+  ASSERT_EQ(61U, rollup.getBuckets(0).size());
+  ASSERT_EQ(61U, rollup.getBuckets(1).size());
+  const auto& second {rollup.getBuckets(0).front()};
+  ASSERT_EQ(now - 900ms, second.start_);
+  ASSERT_EQ(0, second.min_);
+  ASSERT_EQ(9, second.max_);
+  ASSERT_EQ(45, second.sum_);
+  ASSERT_EQ(10U, second.count_);
+  ASSERT_EQ(9, second.last_);
+
+  // the history, the seconds, and the minutes as the range grows
+  auto result {rollup.query(now - 5s, now)};
+  ASSERT_EQ(std::chrono::nanoseconds {0}, result.resolution_);
+  ASSERT_EQ(51U, result.buckets_.size());
+  ASSERT_EQ(now, result.buckets_.back().start_);
+  result = rollup.query(now - 30s, now - 10s);
+  ASSERT_EQ(std::chrono::nanoseconds {1s}, result.resolution_);
+  ASSERT_EQ(21U, result.buckets_.size());
+  ASSERT_LT(result.buckets_.front().start_, result.buckets_.back().start_);
+  result = rollup.query(now - 30min, now);
+  ASSERT_EQ(std::chrono::nanoseconds {1min}, result.resolution_);
+  // the oldest bucket holds now - 30min
+  ASSERT_EQ(31U, result.buckets_.size());
+  ASSERT_EQ(600U, result.buckets_.front().count_);
+  ASSERT_EQ(2'700, result.buckets_.front().sum_);
+  // past the retention of all the tiers: the coarsest one
+  result = rollup.query(now - 10h, now);
+  ASSERT_EQ(61U, result.buckets_.size());
+
+  // a bulk append is rolled up as far as it is in the history
+  memvar::memvarTimed<double> mvd {0.0, 10};
+  memvar::memvarRollup<double> rollupd {mvd, {{1h, 1h}}};
+  const std::vector<double> values {1.5, 2.5, 3.5, -1.0};
+  mvd.append(std::span<const double> {values});
+  ASSERT_EQ(1U, rollupd.getBuckets(0).size());
+  ASSERT_EQ(4U, rollupd.getBuckets(0).front().count_);
+  ASSERT_DOUBLE_EQ(6.5, rollupd.getBuckets(0).front().sum_);
+  ASSERT_DOUBLE_EQ(-1.0, rollupd.getBuckets(0).front().min_);
+  ASSERT_DOUBLE_EQ(3.5, rollupd.getBuckets(0).front().max_);
+  ASSERT_DOUBLE_EQ(-1.0, rollupd.getBuckets(0).front().last_);
+}
+
+TEST(memVarTest, test_19)
+{
+  memvar::memvar<int> mv {0, 4};
+  ASSERT_FALSE(mv.isChangeOnly());
+  mv = 0;
+  ASSERT_EQ(2, mv.getHistorySize());
+
+  mv.setChangeOnly(true);
+  memvar::memvarBase::sequenceType sequence {0};
+  mv.onChange([&sequence] (const int&, const memvar::memvarBase::sequenceType s) { sequence = s; });
+  // the repeated values do not push the older ones out
+  for (int i {0}; i < 100; ++i)
+  {
+    mv = i / 25;
+  }
+  ASSERT_EQ(4, mv.getHistorySize());
+  ASSERT_EQ(3, mv());
+  ASSERT_EQ(0, mv(3));
+  ASSERT_EQ(4U, mv.getSequence());
+  ASSERT_EQ(4U, sequence);
+  ASSERT_EQ(97U, mv.getUnchangedCount());
+
+  // strings too
+  memvar::memvar<std::string> mvs {"on", 10};
+  mvs.setChangeOnly(true);
+  mvs = "on";
+  mvs = "off";
+  mvs = "off";
+  ASSERT_EQ(2, mvs.getHistorySize());
+
+  // within epsilon for floating point, but for a NaN
+  memvar::memvar<double> mvd {0.0, 10};
+  ASSERT_THROW(mvd.setChangeEpsilon(-0.1), std::invalid_argument);
+  mvd.setChangeOnly(true);
+  mvd.setChangeEpsilon(0.5);
+  ASSERT_DOUBLE_EQ(0.5, mvd.getChangeEpsilon());
+  mvd = 0.25;
+  mvd = -0.5;
+  mvd = 0.75;
+  ASSERT_EQ(2, mvd.getHistorySize());
+  mvd = std::numeric_limits<double>::quiet_NaN();
+  mvd = std::numeric_limits<double>::quiet_NaN();
+  ASSERT_EQ(4, mvd.getHistorySize());
+  mvd = std::numeric_limits<double>::infinity();
+  mvd = std::numeric_limits<double>::infinity();
+  ASSERT_EQ(5, mvd.getHistorySize());
+
+  // cleared histories start over with the default value
+  mv.clearHistory();
+  ASSERT_EQ(1, mv.getHistorySize());
+}
+
+TEST(memVarTest, test_20)
+{
+  memvar::memvar<int> mv {0, 10};
+  ASSERT_EQ(memvar::sampling::all, mv.getSampling());
+  ASSERT_THROW(mv.setSampling(memvar::sampling::everyNth, 0), std::invalid_argument);
+  mv.setSampling(memvar::sampling::everyNth, 100);
+  for (int i {1}; i <= 1'050; ++i)
+  {
+    mv = i;
+    // the current value is exact
+    ASSERT_EQ(i, mv());
+  }
+  // the current value, then every 100th write
+  ASSERT_EQ(10, mv.getHistorySize());
+  ASSERT_EQ(1'000, mv(1));
+  ASSERT_EQ(200, mv(9));
+  ASSERT_EQ(1'050U, mv.getSequence());
+  for (int i {1'051}; i <= 1'100; ++i)
+  {
+    mv = i;
+  }
+  // the 1100th write is kept, and the next one goes in front of it
+  ASSERT_EQ(1'100, mv(0));
+  ASSERT_EQ(1'000, mv(1));
+  mv = 1'101;
+  ASSERT_EQ(1'100, mv(1));
+
+  // a million writes evenly spread over the history, in the order written
+  memvar::memvar<int> mvr {0, 1'001};
+  mvr.setSampling(memvar::sampling::reservoir);
+  constexpr int writes {1'000'000};
+  for (int i {1}; i <= writes; ++i)
+  {
+    mvr = i;
+    ASSERT_LE(mvr.getHistorySize(), 1'001);
+  }
+  ASSERT_EQ(writes, mvr());
+  // between half and all of the capacity
+  const auto size {mvr.getHistorySize()};
+  ASSERT_GT(size, 500);
+  // the oldest write is kept, the others a stride apart
+  ASSERT_EQ(0, mvr(size - 1));
+  const auto stride {mvr(size - 2)};
+  ASSERT_EQ(1'024, stride);
+  for (memvar::memvarBase::capacityType i {1}; i < size - 1; ++i)
+  {
+    ASSERT_EQ(stride, mvr(i) - mvr(i + 1));
+  }
+  ASSERT_LT(mvr() - mvr(1), stride);
+
+  // back to every write
+  mvr.setSampling(memvar::sampling::all);
+  mvr = 1;
+  mvr = 2;
+  ASSERT_EQ(1, mvr(1));
+  ASSERT_EQ(writes, mvr(2));
+}
+
+TEST(memVarTest, test_21)
+{
+  memvar::memvar<int> mv {5, 4};
+  auto stats {mv.getLifetimeStats()};
+  ASSERT_EQ(0U, stats.writes_);
+  ASSERT_EQ(0U, stats.evictions_);
+  ASSERT_EQ(5, stats.min_);
+  ASSERT_EQ(5, stats.max_);
+  ASSERT_EQ(5, stats.sum_);
+
+  for (int i {1}; i <= 100; ++i)
+  {
+    mv = (i == 42) ? -1'000 : (i == 77) ? 1'000 : i;
+  }
+  stats = mv.getLifetimeStats();
+  ASSERT_EQ(100U, stats.writes_);
+  // the history keeps the 4 newest values
+  ASSERT_EQ(97U, stats.evictions_);
+  ASSERT_EQ(-1'000, stats.min_);
+  ASSERT_EQ(42U, stats.minSequence_);
+  ASSERT_EQ(1'000, stats.max_);
+  ASSERT_EQ(77U, stats.maxSequence_);
+  ASSERT_EQ(5 + 5'050 - 42 - 1'000 - 77 + 1'000, stats.sum_);
+
+  // the bulk appends count each value
+  const std::vector<int> values {-2'000, 3, 4, 5, 6, 7};
+  mv.append(values);
+  stats = mv.getLifetimeStats();
+  ASSERT_EQ(106U, stats.writes_);
+  ASSERT_EQ(103U, stats.evictions_);
+  ASSERT_EQ(-2'000, stats.min_);
+  ASSERT_EQ(101U, stats.minSequence_);
+
+  // the writes not recorded, and the cleared values
+  mv.setChangeOnly(true);
+  mv = 7;
+  mv.clearHistory();
+  stats = mv.getLifetimeStats();
+  ASSERT_EQ(1U, stats.unchanged_);
+  ASSERT_EQ(107U, stats.writes_);
+  ASSERT_EQ(107U, stats.evictions_);
+  ASSERT_EQ(107U, mv.getWriteCount());
+  ASSERT_EQ(107U, mv.getEvictionCount());
+  std::ostringstream os {};
+  mv.printLifetimeStats(os);
+  ASSERT_EQ("{ writes: 107, unchanged: 1, evictions: 107, min: -2000 #101, max: 1000 #77, sum: 2961 }\n", os.str());
+
+  // the other types count their writes
+  memvar::memvar<std::string> mvs {"a", 2};
+  mvs = "b";
+  mvs = "c";
+  ASSERT_EQ(2U, mvs.getWriteCount());
+  ASSERT_EQ(1U, mvs.getEvictionCount());
+  memvar::memvarTimed<double> mvt {0.5, 10};
+  mvt = -0.5;
+  mvt = 1.5;
+  ASSERT_DOUBLE_EQ(1.5, mvt.getLifetimeStats().sum_);
+  ASSERT_EQ(1U, mvt.getLifetimeStats().minSequence_);
+
+  // the 'zero' value of a cleared history is not a value written: it is not
+  // the min, it is not in the sum, and the subscribers are not called
+  int calls {0};
+  mvt.onChange([&calls] (const double&, memvar::memvarBase::sequenceType) { ++calls; });
+  mvt = 2.0;
+  mvt.clearHistory();
+  ASSERT_EQ(0.0, mvt());
+  ASSERT_EQ(1, calls);
+  ASSERT_EQ(4U, mvt.getWriteCount());
+  ASSERT_EQ(-0.5, mvt.getLifetimeStats().min_);
+  ASSERT_DOUBLE_EQ(3.5, mvt.getLifetimeStats().sum_);
+  memvar::memvar<int> positive {5, 4};
+  positive.onChange([&calls] (const int&, memvar::memvarBase::sequenceType) { ++calls; });
+  positive.clearHistory();
+  positive = 7;
+  ASSERT_EQ(2, calls);
+  ASSERT_EQ(5, positive.getLifetimeStats().min_);
+  ASSERT_EQ(12, positive.getLifetimeStats().sum_);
+  ASSERT_EQ(2U, positive.getLifetimeStats().maxSequence_);
+}
+
+TEST(memVarRangeIndexTest, test_0)
+{
+  memvar::memvar<int> mv {0, 100};
+  for (int i {1}; i < 50; ++i)
+  {
+    mv = (i * 37) % 101;
+  }
+  // the history written before is indexed too
+  memvar::memvarRangeIndex<int> index {mv};
+  ASSERT_EQ(128U, index.getSize());
+  auto scan = [&mv] (const memvar::memvarBase::capacityType first, const memvar::memvarBase::capacityType last) {
+    const auto& history {mv.getMemVarHistory()};
+    const auto [min, max] {std::minmax_element(history.cbegin() + first, history.cbegin() + last + 1)};
+    return std::make_tuple(*min, *max);
+  };
+
+  std::mt19937 generator {42};
+  for (int i {0}; i < 2'000; ++i)
+  {
+    if ( i % 500 == 499 )
+    {
+      const std::vector<int> values {-1, 1'000, 5};
+      mv.append(values);
+    }
+    else
+    {
+      mv = static_cast<int>(generator() % 10'000);
+    }
+    const auto size {mv.getHistorySize()};
+    const auto first {static_cast<memvar::memvarBase::capacityType>(generator() % static_cast<unsigned>(size))};
+    const auto last {first + static_cast<memvar::memvarBase::capacityType>(generator() % static_cast<unsigned>(size - first))};
+    ASSERT_EQ(scan(first, last), index.getRangeMinMax(first, last));
+    ASSERT_EQ(mv.getHistoryMinMax(), index.getLastMinMax(size));
+  }
+  ASSERT_EQ(scan(0, 9), index.getLastMinMax(10));
+  ASSERT_THROW(index.getRangeMinMax(5, 4), std::out_of_range);
+  ASSERT_THROW(index.getRangeMinMax(0, 100), std::out_of_range);
+
+  // a grown capacity rebuilds the tree, a cleared history starts over
+  mv.setHistoryCapacity(300);
+  for (int i {0}; i < 300; ++i)
+  {
+    mv = i;
+  }
+  ASSERT_EQ(512U, index.getSize());
+  ASSERT_EQ(std::make_tuple(0, 299), index.getLastMinMax(300));
+  ASSERT_EQ(std::make_tuple(100, 199), index.getRangeMinMax(100, 199));
+  mv.clearHistory();
+  mv = -7;
+  ASSERT_EQ(std::make_tuple(-7, 0), index.getLastMinMax(1'000));
+
+  memvar::memvar<int> sampled {0, 10};
+  sampled.setSampling(memvar::sampling::everyNth, 2);
+  ASSERT_THROW(memvar::memvarRangeIndex<int> {sampled}, std::invalid_argument);
+
+  // sampling set later makes the index stale, until it is back to all
+  mv.setSampling(memvar::sampling::everyNth, 2);
+  for (int i {1}; i <= 5; ++i)
+  {
+    mv = 100 * i;
+  }
+  ASSERT_TRUE(index.isStale());
+  ASSERT_THROW(index.getLastMinMax(3), std::logic_error);
+  mv.setSampling(memvar::sampling::all);
+  mv = -50;
+  ASSERT_FALSE(index.isStale());
+  for (memvar::memvarBase::capacityType first {0}; first < mv.getHistorySize(); ++first)
+  {
+    for (auto last {first}; last < mv.getHistorySize(); ++last)
+    {
+      ASSERT_EQ(scan(first, last), index.getRangeMinMax(first, last));
+    }
+  }
+}
 ////////////////////////////////////////////////////////////////////////////////